@@ -0,0 +1,490 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "eigen_ik_solver.hpp"
+#include "env_force_kernel.hpp"
+#include "eigen_math.hpp"
+#include "frame_arena.hpp"
+#include "physics_state.hpp"
+#include "spring_world.hpp"
+#include "system_timer.hpp"
+#include "thread_pool.hpp"
+
+// fixed-seed micro- and macro-benchmarks of the solver and spring hot paths;
+// every scenario is rebuilt from the seed before each repetition so runs on
+// the same build and machine are directly comparable
+namespace bench {
+	struct t_bench_params {
+		size_t num_warmups = 3;
+		size_t num_repeats = 15;
+		size_t num_threads = std::thread::hardware_concurrency();
+
+		uint32_t rng_seed = 1234;
+
+		const char* name_filter = nullptr;
+		const char* out_format = "csv";
+	};
+
+	struct t_bench_result {
+		std::string name;
+		std::string config;
+
+		// work-items (solves, steps, ...) per repetition
+		uint64_t num_items;
+
+		std::vector<uint64_t> samples_ns;
+
+		// accuracy of precision-comparison cases (mean distance of the solved
+		// tail to its goal, max distance to the double-precision tail); only
+		// written out when has_errors is set
+		double mean_goal_error = 0.0;
+		double max_ref_error = 0.0;
+
+		bool has_errors = false;
+	};
+
+
+	static t_bench_params g_params;
+	static std::vector<t_bench_result> g_results;
+
+	// keeps the optimizer from discarding benchmarked work
+	static volatile float g_sink = 0.0f;
+
+
+	template<typename t_real>
+	static const char* get_real_name() { return ((sizeof(t_real) == sizeof(double))? "f64": "f32"); }
+
+
+	// reset_func runs untimed before every warmup and repetition; returns
+	// false if the case was filtered out
+	static bool run_case(
+		const std::string& name,
+		const std::string& config,
+		uint64_t num_items,
+		const std::function<void()>& reset_func,
+		const std::function<void()>& run_func
+	) {
+		if (g_params.name_filter != nullptr && name.find(g_params.name_filter) == std::string::npos)
+			return false;
+
+		util::t_system_timer timer;
+		t_bench_result result = {name, config, num_items, {}};
+
+		for (size_t i = 0; i < g_params.num_warmups; i++) {
+			reset_func();
+			run_func();
+		}
+
+		for (size_t i = 0; i < g_params.num_repeats; i++) {
+			reset_func();
+
+			timer.tick_time();
+			run_func();
+			result.samples_ns.push_back(timer.tock_time());
+		}
+
+		std::sort(result.samples_ns.begin(), result.samples_ns.end());
+		std::fprintf(stderr, "[bench::%s] %s %s p50=%.3fms\n", __func__, name.c_str(), config.c_str(), result.samples_ns[result.samples_ns.size() / 2] * 1e-6);
+
+		g_results.push_back(std::move(result));
+		return true;
+	}
+
+
+	static t_pos3f calc_rand_dir(std::mt19937& rng) {
+		std::normal_distribution<float> dist(0.0f, 1.0f);
+
+		for (t_vec3f v; true; ) {
+			if ((v = t_vec3f(dist(rng), dist(rng), dist(rng))).norm() > 1e-3f)
+				return (v.normalized());
+		}
+	}
+
+	// rng draws do not depend on t_real, so both precisions get the same chain
+	template<typename t_real = t_solver_real>
+	static epiks::t_basic_rb_chain<t_real> make_chain(size_t num_pieces, std::mt19937& rng) {
+		std::uniform_real_distribution<float> len_dist(0.2f, 0.8f);
+
+		epiks::t_basic_rb_chain<t_real> chain;
+
+		for (size_t i = 0; i < num_pieces; i++) {
+			chain.add_piece(len_dist(rng));
+		}
+
+		return chain;
+	}
+
+	// same chain, posed by random per-piece rotations
+	template<typename t_real = t_solver_real>
+	static epiks::t_basic_rb_chain<t_real> make_posed_chain(size_t num_pieces, std::mt19937& rng) {
+		std::uniform_real_distribution<float> ang_dist(-0.5f, 0.5f);
+
+		epiks::t_basic_rb_chain<t_real> chain = make_chain<t_real>(num_pieces, rng);
+
+		for (size_t i = 0; i < num_pieces; i++) {
+			chain.get_piece(i).apply_transform(t_vec3<t_real>(ang_dist(rng), ang_dist(rng), ang_dist(rng)));
+		}
+
+		return chain;
+	}
+
+	template<typename t_real>
+	static float calc_chain_length(const epiks::t_basic_rb_chain<t_real>& chain) {
+		float len = 0.0f;
+
+		for (size_t i = 0; i < chain.get_num_pieces(); i++) {
+			len += chain.get_piece(i).get_length();
+		}
+
+		return len;
+	}
+
+
+	enum {
+		GOAL_DIST_REACH = 0, // uniform inside the reachable sphere
+		GOAL_DIST_FAR   = 1, // beyond reach; solver runs out of progress
+		GOAL_DIST_TRACK = 2, // small random walk, like tracking a rope tail
+	};
+
+	static const char* GOAL_DIST_NAMES[] = {"reach", "far", "track"};
+
+	template<typename t_real>
+	static std::vector<t_pos3f> make_goals(const epiks::t_basic_rb_chain<t_real>& chain, uint32_t goal_dist, size_t num_goals, std::mt19937& rng) {
+		std::uniform_real_distribution<float> rad_dist(0.1f, 0.9f);
+		std::vector<t_pos3f> goals;
+
+		const float max_len = calc_chain_length(chain);
+
+		t_pos3f pos = chain.get_base_pos() + calc_rand_dir(rng) * max_len * 0.5f;
+
+		for (size_t i = 0; i < num_goals; i++) {
+			switch (goal_dist) {
+				case GOAL_DIST_REACH: { pos = chain.get_base_pos() + calc_rand_dir(rng) * max_len * rad_dist(rng); } break;
+				case GOAL_DIST_FAR  : { pos = chain.get_base_pos() + calc_rand_dir(rng) * max_len * 1.5f         ; } break;
+				case GOAL_DIST_TRACK: { pos = pos                  + calc_rand_dir(rng) *           0.02f        ; } break;
+			}
+
+			goals.push_back(pos);
+		}
+
+		return goals;
+	}
+
+
+	static void bench_ik_solve() {
+		constexpr size_t NUM_GOALS = 256;
+
+		for (size_t num_pieces: {2, 4, 6, 8, 12, 16}) {
+			for (uint32_t goal_dist = GOAL_DIST_REACH; goal_dist <= GOAL_DIST_TRACK; goal_dist++) {
+				std::mt19937 rng(g_params.rng_seed);
+
+				const epiks::t_rb_chain base_chain = make_chain(num_pieces, rng);
+				const std::vector<t_pos3f> goals = make_goals(base_chain, goal_dist, NUM_GOALS, rng);
+
+				epiks::t_rb_chain chain;
+
+				run_case(
+					"ik_solve",
+					"pieces=" + std::to_string(num_pieces) + ";goals=" + GOAL_DIST_NAMES[goal_dist],
+					NUM_GOALS,
+					[&]() { chain = base_chain; },
+					[&]() {
+						for (const t_pos3f& goal: goals) {
+							chain.solve(goal);
+						}
+
+						g_sink = g_sink + chain.get_tail_pos().x();
+					}
+				);
+			}
+		}
+	}
+
+	// times one precision and measures its accuracy; the first (double) run
+	// for a scenario fills ref_tails, later runs are compared against it
+	template<typename t_real>
+	static void run_ik_precision_case(
+		const std::string& config,
+		const epiks::t_basic_rb_chain<t_real>& base_chain,
+		const std::vector<t_pos3f>& goals,
+		std::vector<t_pos3f>& ref_tails
+	) {
+		epiks::t_basic_rb_chain<t_real> chain;
+
+		const bool ran = run_case(
+			"ik_solve_precision",
+			config + ";real=" + get_real_name<t_real>(),
+			goals.size(),
+			[&]() { chain = base_chain; },
+			[&]() {
+				for (const t_pos3f& goal: goals) {
+					chain.solve(goal);
+				}
+
+				g_sink = g_sink + chain.get_tail_pos().x();
+			}
+		);
+
+		if (!ran)
+			return;
+
+		std::vector<t_pos3f> tails;
+		tails.reserve(goals.size());
+
+		chain = base_chain;
+
+		for (const t_pos3f& goal: goals) {
+			chain.solve(goal);
+			tails.push_back(chain.get_tail_pos());
+		}
+
+		if (ref_tails.empty())
+			ref_tails = tails;
+
+		t_bench_result& r = g_results.back();
+
+		for (size_t i = 0; i < goals.size(); i++) {
+			r.mean_goal_error += ((tails[i] - goals[i]).norm() / goals.size());
+			r.max_ref_error = std::max(r.max_ref_error, double((tails[i] - ref_tails[i]).norm()));
+		}
+
+		r.has_errors = true;
+	}
+
+	// same scenarios solved in double and in float; the difference between
+	// the two is what a float build trades for its speed
+	static void bench_ik_precision() {
+		constexpr size_t NUM_GOALS = 256;
+
+		for (size_t num_pieces: {2, 4, 8, 16}) {
+			for (uint32_t goal_dist = GOAL_DIST_REACH; goal_dist <= GOAL_DIST_TRACK; goal_dist++) {
+				std::mt19937 f64_rng(g_params.rng_seed);
+				std::mt19937 f32_rng(g_params.rng_seed);
+
+				const epiks::t_basic_rb_chain<double> f64_chain = make_chain<double>(num_pieces, f64_rng);
+				const epiks::t_basic_rb_chain<float> f32_chain = make_chain<float>(num_pieces, f32_rng);
+
+				const std::vector<t_pos3f> goals = make_goals(f64_chain, goal_dist, NUM_GOALS, f64_rng);
+				const std::string config = "pieces=" + std::to_string(num_pieces) + ";goals=" + GOAL_DIST_NAMES[goal_dist];
+
+				std::vector<t_pos3f> ref_tails;
+
+				run_ik_precision_case(config, f64_chain, goals, ref_tails);
+				run_ik_precision_case(config, f32_chain, goals, ref_tails);
+			}
+		}
+	}
+
+	static void bench_ik_jacobian() {
+		constexpr size_t NUM_CALLS = 1024;
+
+		for (size_t num_pieces: {2, 4, 6, 8, 12, 16}) {
+			std::mt19937 rng(g_params.rng_seed);
+
+			// pristine pose (and its Jacobian) every repetition starts from
+			const epiks::t_rb_chain posed_chain = make_posed_chain(num_pieces, rng);
+
+			epiks::t_rb_chain::t_matXYr posed_jac_mat;
+			epiks::t_rb_chain::t_matXYr inv_jac_mat(num_pieces * 3, 3);
+
+			epiks::t_rb_chain chain = posed_chain;
+			epiks::t_rb_chain::t_matXYr jac_mat;
+
+			Eigen::JacobiSVD<epiks::t_rb_chain::t_matXYr> svd_mat;
+			util::t_frame_arena& arena = util::t_frame_arena::get_thread_arena();
+
+			chain.calc_jacobian(chain.calc_tail_pos(), posed_jac_mat);
+
+			const auto reset_func = [&]() {
+				chain = posed_chain;
+				jac_mat = posed_jac_mat;
+			};
+
+			// each call perturbs and restores every piece, which need not round-trip
+			// exactly; the end-effector position is re-derived per call like solve does
+			run_case("ik_jacobian", "pieces=" + std::to_string(num_pieces), NUM_CALLS, reset_func, [&]() {
+				for (size_t i = 0; i < NUM_CALLS; i++) {
+					chain.calc_jacobian(chain.calc_tail_pos(), jac_mat);
+					g_sink = g_sink + jac_mat(0, 0);
+				}
+			});
+
+			run_case("ik_pseudo_inverse", "pieces=" + std::to_string(num_pieces), NUM_CALLS, reset_func, [&]() {
+				for (size_t i = 0; i < NUM_CALLS; i++) {
+					math::calc_pseudo_inverse(jac_mat, svd_mat, inv_jac_mat, arena);
+					g_sink = g_sink + inv_jac_mat(0, 0);
+				}
+			});
+		}
+	}
+
+
+	static epiks::t_spring_grid make_grid(size_t num_links_x, size_t num_links_y) {
+		const epiks::t_spring_grid_params gp = {num_links_x, num_links_y, consts::ROPE_PARAMS.link_mass, 0.0f, consts::ROPE_PARAMS.gravity_acc};
+		const epiks::t_spring_anchor anchor = {0, {0.0f, num_links_y * consts::SPRING_PARAMS.rest_length + 1.0f, 0.0f}, {0.0f, 0.0f, 0.0f}};
+
+		epiks::t_spring_grid grid = {gp, consts::SPRING_PARAMS, consts::WORLD_PARAMS};
+
+		grid.add_anchor(anchor);
+		return grid;
+	}
+
+	static void bench_spring_world() {
+		constexpr size_t NUM_STEPS = 16;
+
+		const size_t grid_sizes[][2] = {{1, 30}, {16, 16}, {32, 32}, {64, 64}, {128, 128}};
+
+		util::t_thread_pool thread_pool(g_params.num_threads);
+
+		for (const auto& grid_size: grid_sizes) {
+			std::unique_ptr<epiks::t_spring_world> world;
+
+			run_case(
+				"spring_world_update",
+				"grid=" + std::to_string(grid_size[0]) + "x" + std::to_string(grid_size[1]) + ";threads=" + std::to_string(thread_pool.get_num_threads()) + ";accum=" + get_real_name<t_accum_real>() + ";isa=" + epiks::get_env_force_isa(),
+				NUM_STEPS,
+				[&]() {
+					world = std::make_unique<epiks::t_spring_world>();
+					world->add_grid(make_grid(grid_size[0], grid_size[1]));
+				},
+				[&]() {
+					for (size_t i = 0; i < NUM_STEPS; i++) {
+						world->update(consts::SIM_STEP_SIZE, thread_pool);
+					}
+
+					g_sink = g_sink + world->get_pos(world->get_num_objects() - 1).y();
+				}
+			);
+		}
+	}
+
+	static void bench_physics_step() {
+		constexpr size_t NUM_STEPS = 120;
+
+		std::unique_ptr<epiks::t_physics_state> state;
+
+		// default scene; the state owns its own (hardware-sized) thread pool
+		run_case(
+			"physics_step",
+			"scene=default;arms=" + std::to_string(epiks::t_physics_state::NUM_DEFAULT_ARMS) + ";solver=" + get_real_name<t_solver_real>() + ";accum=" + get_real_name<t_accum_real>() + ";isa=" + epiks::get_env_force_isa(),
+			NUM_STEPS,
+			[&]() {
+				state = std::make_unique<epiks::t_physics_state>();
+				state->init();
+			},
+			[&]() {
+				for (size_t i = 0; i < NUM_STEPS; i++) {
+					state->step(consts::SIM_STEP_SIZE);
+				}
+
+				g_sink = g_sink + state->get_chain(0).get_tail_pos().y();
+			}
+		);
+	}
+
+
+	static void output_results(FILE* out) {
+		const auto calc_mean = [](const std::vector<uint64_t>& s) {
+			uint64_t sum = 0;
+			for (uint64_t v: s) {
+				sum += v;
+			}
+			return (double(sum) / s.size());
+		};
+
+		if (std::strcmp(g_params.out_format, "json") == 0) {
+			std::fprintf(out, "{\"seed\":%u,\"warmups\":%lu,\"repeats\":%lu,\"results\":[\n", g_params.rng_seed, (unsigned long) g_params.num_warmups, (unsigned long) g_params.num_repeats);
+
+			for (size_t i = 0; i < g_results.size(); i++) {
+				const t_bench_result& r = g_results[i];
+				const std::vector<uint64_t>& s = r.samples_ns;
+
+				std::fprintf(out, "  {\"name\":\"%s\",\"config\":\"%s\",\"items\":%lu,\"min_ns\":%lu,\"p50_ns\":%lu,\"mean_ns\":%.1f,\"max_ns\":%lu,\"ns_per_item\":%.1f",
+					r.name.c_str(),
+					r.config.c_str(),
+					(unsigned long) r.num_items,
+					(unsigned long) s.front(),
+					(unsigned long) s[s.size() / 2],
+					calc_mean(s),
+					(unsigned long) s.back(),
+					double(s[s.size() / 2]) / r.num_items
+				);
+
+				if (r.has_errors)
+					std::fprintf(out, ",\"mean_goal_error\":%g,\"max_ref_error\":%g", r.mean_goal_error, r.max_ref_error);
+
+				std::fprintf(out, "}%s\n", ((i + 1) < g_results.size())? ",": "");
+			}
+
+			std::fprintf(out, "]}\n");
+		} else {
+			std::fprintf(out, "name,config,items,min_ns,p50_ns,mean_ns,max_ns,ns_per_item,mean_goal_error,max_ref_error\n");
+
+			for (const t_bench_result& r: g_results) {
+				const std::vector<uint64_t>& s = r.samples_ns;
+
+				std::fprintf(out, "%s,%s,%lu,%lu,%lu,%.1f,%lu,%.1f,",
+					r.name.c_str(),
+					r.config.c_str(),
+					(unsigned long) r.num_items,
+					(unsigned long) s.front(),
+					(unsigned long) s[s.size() / 2],
+					calc_mean(s),
+					(unsigned long) s.back(),
+					double(s[s.size() / 2]) / r.num_items
+				);
+
+				if (r.has_errors) {
+					std::fprintf(out, "%g,%g\n", r.mean_goal_error, r.max_ref_error);
+				} else {
+					std::fprintf(out, ",\n");
+				}
+			}
+		}
+	}
+};
+
+
+int main(int argc, char** argv) {
+	const char* out_file = nullptr;
+
+	for (int i = 1; (i + 1) < argc; i++) {
+		if (std::strcmp(argv[i], "--warmups") == 0) { bench::g_params.num_warmups = std::strtoul(argv[++i], nullptr, 10); continue; }
+		if (std::strcmp(argv[i], "--repeats") == 0) { bench::g_params.num_repeats = std::strtoul(argv[++i], nullptr, 10); continue; }
+		if (std::strcmp(argv[i], "--threads") == 0) { bench::g_params.num_threads = std::strtoul(argv[++i], nullptr, 10); continue; }
+		if (std::strcmp(argv[i], "--seed"   ) == 0) { bench::g_params.rng_seed    = std::strtoul(argv[++i], nullptr, 10); continue; }
+		if (std::strcmp(argv[i], "--filter" ) == 0) { bench::g_params.name_filter = argv[++i]; continue; }
+		if (std::strcmp(argv[i], "--format" ) == 0) { bench::g_params.out_format  = argv[++i]; continue; }
+		if (std::strcmp(argv[i], "--out"    ) == 0) { out_file                    = argv[++i]; continue; }
+	}
+
+	bench::g_params.num_repeats = std::max(bench::g_params.num_repeats, size_t(1));
+	bench::g_params.num_threads = std::max(bench::g_params.num_threads, size_t(1));
+
+	bench::bench_ik_solve();
+	bench::bench_ik_precision();
+	bench::bench_ik_jacobian();
+	bench::bench_spring_world();
+	bench::bench_physics_step();
+
+	FILE* out = (out_file != nullptr)? std::fopen(out_file, "w"): stdout;
+
+	if (out == nullptr) {
+		std::fprintf(stderr, "[%s] can not open \"%s\"\n", __func__, out_file);
+		return 1;
+	}
+
+	bench::output_results(out);
+
+	if (out != stdout)
+		std::fclose(out);
+
+	return 0;
+}
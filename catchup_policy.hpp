@@ -0,0 +1,67 @@
+#ifndef EIGENPHYSIKS_CATCHUP_POLICY_HDR
+#define EIGENPHYSIKS_CATCHUP_POLICY_HDR
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+
+namespace util {
+	struct t_catchup_stats {
+	public:
+		void output(FILE* out, const char* name) {
+			std::fprintf(out, "[catchup::%s] {late,dropped}_steps={%lu,%lu} overloads=%lu\n", name,
+				(unsigned long) late_steps.exchange(0, std::memory_order_relaxed),
+				(unsigned long) dropped_steps.exchange(0, std::memory_order_relaxed),
+				(unsigned long) num_overloads.exchange(0, std::memory_order_relaxed)
+			);
+		}
+
+	public:
+		// written by the stepping thread, read (and reset) by the reporting one
+		std::atomic<uint64_t> late_steps = {0}; // steps run back-to-back to catch up
+		std::atomic<uint64_t> dropped_steps = {0}; // steps whose time was given up on
+		std::atomic<uint64_t> num_overloads = {0}; // times more steps were owed than allowed
+	};
+
+
+	// bounds how many fixed steps are executed to pay off accumulated time
+	// (debt), so a tick that is slower than real-time can not make every
+	// following frame longer than the last
+	struct t_catchup_policy {
+	public:
+		enum {
+			MODE_DROP   = 0, // forget all debt beyond max_steps; sim skips ahead in wall-time
+			MODE_DILATE = 1, // carry up to max_debt_steps over; sim runs slower than wall-time
+		};
+
+		// returns the number of steps to execute for debt_ns, and removes the
+		// part of the debt the policy gives up on from it
+		uint32_t calc_num_steps(uint64_t& debt_ns, uint64_t step_ns, t_catchup_stats& stats) const {
+			const uint64_t num_owed = debt_ns / step_ns;
+			const uint64_t num_steps = std::min(num_owed, uint64_t(max_steps));
+			const uint64_t num_excess = num_owed - num_steps;
+
+			if (num_steps > 1)
+				stats.late_steps.fetch_add(num_steps - 1, std::memory_order_relaxed);
+
+			if (num_excess == 0)
+				return num_steps;
+
+			const uint64_t num_carry = (mode == MODE_DILATE)? std::min(num_excess, uint64_t(max_debt_steps)): 0;
+			const uint64_t num_drops = num_excess - num_carry;
+
+			stats.num_overloads.fetch_add(1, std::memory_order_relaxed);
+			stats.dropped_steps.fetch_add(num_drops, std::memory_order_relaxed);
+
+			debt_ns -= (num_drops * step_ns);
+			return num_steps;
+		}
+
+	public:
+		uint32_t mode = MODE_DILATE;
+		uint32_t max_steps = 4; // per frame, or per wake-up of the physics thread
+		uint32_t max_debt_steps = 4;
+	};
+};
+
+#endif
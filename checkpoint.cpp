@@ -0,0 +1,396 @@
+#include <cstdio>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "checkpoint.hpp"
+#include "physics_state.hpp"
+#include "profiler.hpp"
+
+static constexpr uint64_t SECTION_ALIGNMENT = 16;
+
+static const uint64_t SECTION_RECORD_SIZES[epiks::ckpt::NUM_SECTIONS] = {
+	sizeof(float) * 3,
+	sizeof(float) * 3,
+	sizeof(uint32_t) * 2,
+	sizeof(epiks::ckpt::t_grid_record),
+	sizeof(epiks::ckpt::t_anchor_record),
+	sizeof(epiks::ckpt::t_chain_record),
+	sizeof(epiks::ckpt::t_piece_record),
+	sizeof(epiks::ckpt::t_attachment_record),
+};
+
+static_assert(sizeof(t_pos3f) == sizeof(float) * 3, "positions are stored as raw float triplets");
+static_assert(sizeof(t_vec3f) == sizeof(float) * 3, "velocities are stored as raw float triplets");
+
+
+static uint64_t align_offset(uint64_t offset) { return ((offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1)); }
+
+static void store_vec(float* dst, const t_vec3f& v) { dst[0] = v.x(); dst[1] = v.y(); dst[2] = v.z(); }
+static void store_rot(float* dst, const t_rot4f& r) { dst[0] = r.angle(); dst[1] = r.axis().x(); dst[2] = r.axis().y(); dst[3] = r.axis().z(); }
+
+static t_vec3f load_vec(const float* src) { return {src[0], src[1], src[2]}; }
+static t_rot4f load_rot(const float* src) { return {src[0], t_vec3f(src[1], src[2], src[3])}; }
+
+
+bool epiks::save_checkpoint(const t_physics_state& ps, const char* file_name) {
+	EIGENPHYSIKS_PROFILE_ZONE("ckpt::save");
+
+	const t_spring_world& world = ps.get_spring_world();
+
+	std::vector<uint32_t> springs;
+	std::vector<ckpt::t_grid_record> grids;
+	std::vector<ckpt::t_anchor_record> anchors;
+	std::vector<ckpt::t_chain_record> chains;
+	std::vector<ckpt::t_piece_record> pieces;
+	std::vector<ckpt::t_attachment_record> attachments;
+
+	springs.reserve(world.get_num_springs() * 2);
+
+	for (size_t i = 0; i < world.get_num_springs(); i++) {
+		springs.push_back(world.get_spring(i).get_lhs_obj_idx());
+		springs.push_back(world.get_spring(i).get_rhs_obj_idx());
+	}
+
+	for (size_t i = 0; i < world.get_num_grids(); i++) {
+		const t_spring_grid& g = world.get_grid(i);
+		const t_spring_grid_params& gp = g.get_grid_params();
+		const t_spring_base_params& bp = g.get_base_params();
+		const t_world_params& wp = g.get_world_params();
+
+		ckpt::t_grid_record r = {};
+
+		r.num_links_x = gp.num_links_x;
+		r.num_links_y = gp.num_links_y;
+		r.obj_offset = g.get_obj_offset();
+		r.spring_offset = g.get_spring_offset();
+		r.num_springs = g.get_num_springs();
+		r.anchor_offset = anchors.size();
+		r.num_anchors = g.get_num_anchors();
+		r.link_mass = gp.link_mass;
+
+		store_vec(r.gravity_acc, gp.gravity_acc);
+
+		r.base_params[0] = bp.rest_length;
+		r.base_params[1] = bp.thickness;
+		r.base_params[2] = bp.stiff_const;
+		r.base_params[3] = bp.frict_const;
+
+		r.world_params[0] = wp.atmos_frict_coeff;
+		r.world_params[1] = wp.ground_repul_coeff;
+		r.world_params[2] = wp.ground_frict_coeff;
+		r.world_params[3] = wp.ground_absor_coeff;
+		r.world_params[4] = wp.ground_plane_level;
+		r.world_params[5] = wp.ground_plane_scale;
+
+		grids.push_back(r);
+
+		for (size_t j = 0; j < g.get_num_anchors(); j++) {
+			ckpt::t_anchor_record a = {};
+
+			a.obj_idx = g.get_anchor(j).obj_idx;
+
+			store_vec(a.pos, g.get_anchor(j).pos);
+			store_vec(a.vel, g.get_anchor(j).vel);
+
+			anchors.push_back(a);
+		}
+	}
+
+	for (size_t i = 0; i < ps.get_num_chains(); i++) {
+		const t_rb_chain& chain = ps.get_chain(i);
+
+		ckpt::t_chain_record c = {};
+
+		store_vec(c.base_pos, chain.get_base_pos());
+		store_vec(c.goal_pos, chain.get_goal_pos());
+		store_vec(c.tail_pos, chain.get_tail_pos());
+		store_vec(c.prev_pull_pos, ps.get_prev_tail_pos(i));
+		store_vec(c.curr_pull_pos, ps.get_curr_tail_pos(i));
+
+		c.piece_offset = pieces.size();
+		c.num_pieces = chain.get_num_pieces();
+
+		chains.push_back(c);
+
+		for (const t_rb_piece& piece: chain.get_pieces()) {
+			ckpt::t_piece_record p = {};
+
+			p.length = piece.get_length();
+
+			store_rot(p.curr_trans, piece.get_transform());
+			store_rot(p.iter_trans, piece.get_iter_transform());
+			store_rot(p.best_trans, piece.get_best_transform());
+
+			pieces.push_back(p);
+		}
+	}
+
+	for (size_t i = 0; i < ps.get_num_attachments(); i++) {
+		const t_chain_attachment& ca = ps.get_attachment(i);
+
+		attachments.push_back({uint32_t(ca.chain_idx), uint32_t(ca.grid_idx), uint32_t(ca.obj_idx), ca.pull_coeff});
+	}
+
+
+	const void* section_datas[ckpt::NUM_SECTIONS] = {
+		world.get_positions(),
+		world.get_velocities(),
+		springs.data(),
+		grids.data(),
+		anchors.data(),
+		chains.data(),
+		pieces.data(),
+		attachments.data(),
+	};
+
+	ckpt::t_file_header header = {};
+
+	header.magic = ckpt::FILE_MAGIC;
+	header.version = ckpt::FILE_VERSION;
+	header.endian_tag = ckpt::ENDIAN_TAG;
+	header.num_ticks = ps.get_num_ticks();
+
+	header.section_counts[ckpt::SECTION_POSITIONS  ] = world.get_num_objects();
+	header.section_counts[ckpt::SECTION_VELOCITIES ] = world.get_num_objects();
+	header.section_counts[ckpt::SECTION_SPRINGS    ] = world.get_num_springs();
+	header.section_counts[ckpt::SECTION_GRIDS      ] = grids.size();
+	header.section_counts[ckpt::SECTION_ANCHORS    ] = anchors.size();
+	header.section_counts[ckpt::SECTION_CHAINS     ] = chains.size();
+	header.section_counts[ckpt::SECTION_PIECES     ] = pieces.size();
+	header.section_counts[ckpt::SECTION_ATTACHMENTS] = attachments.size();
+
+	uint64_t offset = align_offset(sizeof(header));
+
+	for (uint32_t i = 0; i < ckpt::NUM_SECTIONS; i++) {
+		header.section_offsets[i] = offset;
+		offset = align_offset(offset + header.section_counts[i] * SECTION_RECORD_SIZES[i]);
+	}
+
+	header.file_size = offset;
+
+
+	FILE* file = std::fopen(file_name, "wb");
+
+	if (file == nullptr) {
+		std::fprintf(stderr, "[ckpt::%s] can not open \"%s\"\n", __func__, file_name);
+		return false;
+	}
+
+	const uint8_t padding[SECTION_ALIGNMENT] = {};
+
+	uint64_t file_offset = sizeof(header);
+
+	bool ret = (std::fwrite(&header, sizeof(header), 1, file) == 1);
+
+	// sections, each preceded by zero-padding up to its aligned offset; the
+	// next-offset of the last section is file_size, so it is padded as well
+	for (uint32_t i = 0; i <= ckpt::NUM_SECTIONS && ret; i++) {
+		const uint64_t next_offset = (i < ckpt::NUM_SECTIONS)? header.section_offsets[i]: header.file_size;
+		const uint64_t num_bytes = (i < ckpt::NUM_SECTIONS)? (header.section_counts[i] * SECTION_RECORD_SIZES[i]): 0;
+
+		ret &= (next_offset == file_offset || std::fwrite(padding, next_offset - file_offset, 1, file) == 1);
+		ret &= (num_bytes == 0 || std::fwrite(section_datas[i], num_bytes, 1, file) == 1);
+
+		file_offset = next_offset + num_bytes;
+	}
+
+	ret &= (std::fclose(file) == 0);
+
+	if (!ret)
+		std::fprintf(stderr, "[ckpt::%s] failed writing \"%s\"\n", __func__, file_name);
+
+	return ret;
+}
+
+bool epiks::load_checkpoint(t_physics_state& ps, const char* file_name) {
+	EIGENPHYSIKS_PROFILE_ZONE("ckpt::load");
+
+	const int fd = open(file_name, O_RDONLY);
+
+	if (fd < 0) {
+		std::fprintf(stderr, "[ckpt::%s] can not open \"%s\"\n", __func__, file_name);
+		return false;
+	}
+
+	struct stat st;
+
+	if (fstat(fd, &st) != 0 || uint64_t(st.st_size) < sizeof(ckpt::t_file_header)) {
+		std::fprintf(stderr, "[ckpt::%s] \"%s\" is too small\n", __func__, file_name);
+		close(fd);
+		return false;
+	}
+
+	const uint64_t file_size = st.st_size;
+
+	// read-only private mapping; sections are only touched (paged in) by the copies below
+	void* file_addr = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	close(fd);
+
+	if (file_addr == MAP_FAILED) {
+		std::fprintf(stderr, "[ckpt::%s] can not map \"%s\"\n", __func__, file_name);
+		return false;
+	}
+
+	madvise(file_addr, file_size, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+	const uint8_t* file_data = reinterpret_cast<const uint8_t*>(file_addr);
+	const ckpt::t_file_header& header = *reinterpret_cast<const ckpt::t_file_header*>(file_data);
+
+	const auto get_section = [&](uint32_t i) { return (file_data + header.section_offsets[i]); };
+	const auto is_valid = [&]() {
+		if (header.magic != ckpt::FILE_MAGIC || header.version != ckpt::FILE_VERSION || header.endian_tag != ckpt::ENDIAN_TAG)
+			return false;
+		if (header.file_size != file_size)
+			return false;
+
+		for (uint32_t i = 0; i < ckpt::NUM_SECTIONS; i++) {
+			if ((header.section_offsets[i] % SECTION_ALIGNMENT) != 0)
+				return false;
+			// offset first, so neither check below can wrap around
+			if (header.section_offsets[i] > file_size)
+				return false;
+			if (header.section_counts[i] > ((file_size - header.section_offsets[i]) / SECTION_RECORD_SIZES[i]))
+				return false;
+		}
+
+		return (header.section_counts[ckpt::SECTION_POSITIONS] == header.section_counts[ckpt::SECTION_VELOCITIES]);
+	};
+
+	if (!is_valid()) {
+		std::fprintf(stderr, "[ckpt::%s] \"%s\" is not a version-%u checkpoint\n", __func__, file_name, ckpt::FILE_VERSION);
+		munmap(file_addr, file_size);
+		return false;
+	}
+
+	const uint64_t num_objects = header.section_counts[ckpt::SECTION_POSITIONS];
+	const uint64_t num_springs = header.section_counts[ckpt::SECTION_SPRINGS];
+	const uint64_t num_grids = header.section_counts[ckpt::SECTION_GRIDS];
+	const uint64_t num_anchors = header.section_counts[ckpt::SECTION_ANCHORS];
+	const uint64_t num_chains = header.section_counts[ckpt::SECTION_CHAINS];
+	const uint64_t num_pieces = header.section_counts[ckpt::SECTION_PIECES];
+	const uint64_t num_attachments = header.section_counts[ckpt::SECTION_ATTACHMENTS];
+
+	const uint32_t* spring_data = reinterpret_cast<const uint32_t*>(get_section(ckpt::SECTION_SPRINGS));
+
+	const ckpt::t_grid_record* grid_records = reinterpret_cast<const ckpt::t_grid_record*>(get_section(ckpt::SECTION_GRIDS));
+	const ckpt::t_anchor_record* anchor_records = reinterpret_cast<const ckpt::t_anchor_record*>(get_section(ckpt::SECTION_ANCHORS));
+	const ckpt::t_chain_record* chain_records = reinterpret_cast<const ckpt::t_chain_record*>(get_section(ckpt::SECTION_CHAINS));
+	const ckpt::t_piece_record* piece_records = reinterpret_cast<const ckpt::t_piece_record*>(get_section(ckpt::SECTION_PIECES));
+	const ckpt::t_attachment_record* attachment_records = reinterpret_cast<const ckpt::t_attachment_record*>(get_section(ckpt::SECTION_ATTACHMENTS));
+
+	std::vector<t_spring_grid> grids;
+	std::vector<t_spring_object> springs;
+
+	std::vector<t_rb_chain> chains;
+	std::vector<t_chain_attachment> attachments;
+
+	std::vector<t_pos3f> prev_pull_positions;
+	std::vector<t_pos3f> curr_pull_positions;
+
+	bool ret = true;
+
+	grids.reserve(num_grids);
+	springs.reserve(num_springs);
+	chains.reserve(num_chains);
+	attachments.reserve(num_attachments);
+
+	for (uint64_t i = 0; i < num_springs; i++) {
+		ret &= (spring_data[i * 2 + 0] < num_objects && spring_data[i * 2 + 1] < num_objects);
+		springs.emplace_back(spring_data[i * 2 + 0], spring_data[i * 2 + 1]);
+	}
+
+	for (uint64_t i = 0; i < num_grids && ret; i++) {
+		const ckpt::t_grid_record& r = grid_records[i];
+
+		const t_spring_grid_params gp = {r.num_links_x, r.num_links_y, r.link_mass, 0.0f, load_vec(r.gravity_acc)};
+		const t_spring_base_params bp = {r.base_params[0], r.base_params[1], r.base_params[2], r.base_params[3]};
+		const t_world_params wp = {r.world_params[0], r.world_params[1], r.world_params[2], r.world_params[3], r.world_params[4], r.world_params[5]};
+
+		// written as remaining-space checks since every field is untrusted
+		ret &= (r.obj_offset <= num_objects && r.num_links_x != 0 && r.num_links_y <= ((num_objects - r.obj_offset) / r.num_links_x));
+		ret &= (r.spring_offset <= num_springs && r.num_springs <= (num_springs - r.spring_offset));
+		ret &= (r.anchor_offset <= num_anchors && r.num_anchors <= (num_anchors - r.anchor_offset));
+
+		if (!ret)
+			break;
+
+		grids.emplace_back(gp, bp, wp);
+		grids.back().set_ranges(r.obj_offset, r.spring_offset, r.num_springs);
+
+		for (uint64_t j = r.anchor_offset; j < (r.anchor_offset + r.num_anchors) && ret; j++) {
+			// grid-space, like attachments below
+			if (!(ret &= (anchor_records[j].obj_idx < grids.back().get_num_objects())))
+				break;
+
+			grids.back().add_anchor({anchor_records[j].obj_idx, load_vec(anchor_records[j].pos), load_vec(anchor_records[j].vel)});
+		}
+	}
+
+	for (uint64_t i = 0; i < num_chains && ret; i++) {
+		const ckpt::t_chain_record& c = chain_records[i];
+
+		if (!(ret &= ((uint64_t(c.piece_offset) + c.num_pieces) <= num_pieces)))
+			break;
+
+		t_rb_chain chain;
+
+		chain.set_base_pos(load_vec(c.base_pos));
+		chain.set_goal_pos(load_vec(c.goal_pos));
+		chain.set_tail_pos(load_vec(c.tail_pos));
+
+		for (uint32_t j = c.piece_offset; j < (c.piece_offset + c.num_pieces); j++) {
+			const ckpt::t_piece_record& p = piece_records[j];
+
+			chain.add_piece(p.length);
+			chain.get_pieces().back().set_transforms(load_rot(p.curr_trans), load_rot(p.iter_trans), load_rot(p.best_trans));
+		}
+
+		prev_pull_positions.push_back(load_vec(c.prev_pull_pos));
+		curr_pull_positions.push_back(load_vec(c.curr_pull_pos));
+
+		chains.push_back(chain);
+	}
+
+	for (uint64_t i = 0; i < num_attachments && ret; i++) {
+		const ckpt::t_attachment_record& a = attachment_records[i];
+
+		if (!(ret &= (a.chain_idx < num_chains && a.grid_idx < num_grids)))
+			break;
+		if (!(ret &= (a.obj_idx < grids[a.grid_idx].get_num_objects())))
+			break;
+
+		attachments.push_back({a.chain_idx, a.grid_idx, a.obj_idx, a.pull_coeff});
+	}
+
+	// binary scenes are checkpoints, so they get the same checks as text ones
+	const char* what = ret? check_scene(grids, chains): "out-of-range indices";
+
+	if (what == nullptr) {
+		for (const t_rb_chain& chain: chains) {
+			ps.add_chain(chain);
+		}
+		for (const t_chain_attachment& a: attachments) {
+			ps.add_attachment(a);
+		}
+
+		ps.get_spring_world().restore(
+			grids,
+			springs,
+			reinterpret_cast<const t_pos3f*>(get_section(ckpt::SECTION_POSITIONS)),
+			reinterpret_cast<const t_vec3f*>(get_section(ckpt::SECTION_VELOCITIES)),
+			num_objects
+		);
+
+		ps.init_restored(header.num_ticks, prev_pull_positions.data(), curr_pull_positions.data());
+	} else {
+		std::fprintf(stderr, "[ckpt::%s] \"%s\": %s\n", __func__, file_name, what);
+	}
+
+	munmap(file_addr, file_size);
+	return (what == nullptr);
+}
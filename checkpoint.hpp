@@ -0,0 +1,104 @@
+#ifndef EIGENPHYSIKS_CHECKPOINT_HDR
+#define EIGENPHYSIKS_CHECKPOINT_HDR
+
+#include <cstdint>
+
+namespace epiks {
+	struct t_physics_state;
+
+	// binary checkpoint layout (little-endian, every section 16-byte aligned);
+	// object positions and velocities are stored as raw float triplets so a
+	// loaded file only has to be paged in and copied, never parsed
+	namespace ckpt {
+		static constexpr uint64_t FILE_MAGIC = 0x4b4843534b495045ull; // "EPIKSCHK"
+		static constexpr uint32_t FILE_VERSION = 1;
+		static constexpr uint32_t ENDIAN_TAG = 0x01020304u;
+
+		enum {
+			SECTION_POSITIONS   = 0, // float[3] per object
+			SECTION_VELOCITIES  = 1, // float[3] per object
+			SECTION_SPRINGS     = 2, // uint32[2] per spring, world-space
+			SECTION_GRIDS       = 3, // t_grid_record per grid
+			SECTION_ANCHORS     = 4, // t_anchor_record per anchor (all grids)
+			SECTION_CHAINS      = 5, // t_chain_record per chain
+			SECTION_PIECES      = 6, // t_piece_record per piece (all chains)
+			SECTION_ATTACHMENTS = 7, // t_attachment_record per attachment
+			NUM_SECTIONS        = 8,
+		};
+
+		struct t_file_header {
+			uint64_t magic;
+			uint32_t version;
+			uint32_t endian_tag;
+
+			uint64_t file_size;
+			uint64_t num_ticks;
+
+			uint64_t section_counts[NUM_SECTIONS];
+			uint64_t section_offsets[NUM_SECTIONS];
+		};
+
+		struct t_grid_record {
+			uint64_t num_links_x;
+			uint64_t num_links_y;
+
+			uint64_t obj_offset;
+			uint64_t spring_offset;
+			uint64_t num_springs;
+			uint64_t anchor_offset;
+			uint64_t num_anchors;
+
+			float link_mass;
+			float gravity_acc[3];
+
+			float base_params[4]; // t_spring_base_params
+			float world_params[6]; // t_world_params
+		};
+
+		struct t_anchor_record {
+			uint64_t obj_idx; // grid-space
+
+			float pos[3];
+			float vel[3];
+		};
+
+		struct t_chain_record {
+			float base_pos[3];
+			float goal_pos[3];
+			float tail_pos[3];
+
+			// pull targets of the multi-rate schedule
+			float prev_pull_pos[3];
+			float curr_pull_pos[3];
+
+			uint32_t piece_offset;
+			uint32_t num_pieces;
+		};
+
+		struct t_piece_record {
+			float length;
+
+			// {angle, axis.x, axis.y, axis.z}
+			float curr_trans[4];
+			float iter_trans[4];
+			float best_trans[4];
+		};
+
+		struct t_attachment_record {
+			uint32_t chain_idx;
+			uint32_t grid_idx;
+			uint32_t obj_idx; // grid-space
+
+			float pull_coeff;
+		};
+	};
+
+
+	bool save_checkpoint(const t_physics_state& ps, const char* file_name);
+
+	// ps must be freshly constructed (not init'ed); its rates are kept,
+	// everything else comes from the file
+	bool load_checkpoint(t_physics_state& ps, const char* file_name);
+};
+
+#endif
@@ -2,27 +2,96 @@
 #include <GL/gl.h>
 #include <GL/freeglut.h>
 
+#include <chrono>
+
+#include "checkpoint.hpp"
 #include "eigen_engine.hpp"
+#include "profiler.hpp"
+#include "scene_loader.hpp"
+
+static uint64_t get_steady_time_ns() {
+	return (std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
 
-void epiks::t_eigen_engine::loop() {
-	init();
+void epiks::t_eigen_engine::loop(bool threaded) {
+	init(threaded);
 	glutMainLoop();
 	kill();
 }
 
+void epiks::t_eigen_engine::init(bool threaded) {
+	if (m_shm_view_name != nullptr) {
+		// as for replays, ticks only pick up whatever the exporter last published
+		if (!m_shm_reader.open(m_shm_view_name) || !m_shm_reader.read_frame(m_snapshots.get_back()))
+			exit(1);
+
+		m_snapshots.get_back().tick_index = m_num_ticks;
+	} else if (m_replay_file != nullptr) {
+		// replays need no physics at all, ticks only advance the recording
+		if (!m_frame_player.open(m_replay_file) || !m_frame_player.read_frame(m_snapshots.get_back()))
+			exit(1);
+
+		m_snapshots.get_back().tick_index = m_num_ticks;
+	} else {
+		if (m_checkpoint_file != nullptr) {
+			if (!epiks::load_checkpoint(m_physics_state, m_checkpoint_file))
+				exit(1);
+		} else if (m_scene_file != nullptr) {
+			if (!epiks::load_scene(m_physics_state, m_scene_file))
+				exit(1);
+		} else {
+			m_physics_state.init();
+		}
+
+		m_snapshots.get_back().capture(m_physics_state, m_num_ticks);
+	}
+
+	m_snapshots.get_back().publish_time_ns = get_steady_time_ns();
+	m_snapshots.publish();
+	m_snapshots.consume();
+
+	m_prev_snapshot.copy_state(m_snapshots.get_front());
+
+	m_render_state.init(m_snapshots.get_front());
+
+	if (m_record_file != nullptr)
+		m_frame_recorder.start(m_record_file);
+	if (m_shm_export_name != nullptr)
+		m_shm_exporter.start(m_shm_export_name, m_snapshots.get_front());
+
+	if (threaded) {
+		m_physics_thread.set_catchup_policy(m_catchup_policy);
+		m_physics_thread.start([this]() { update_tick(); });
+	}
+}
+
+void epiks::t_eigen_engine::kill() {
+	m_physics_thread.stop();
+	m_frame_recorder.stop();
+	m_frame_player.close();
+	m_shm_exporter.stop();
+	m_shm_reader.close();
+	m_render_state.kill();
+	m_physics_state.kill();
+}
+
 
 void epiks::t_eigen_engine::handle_input(float dt) {
 	opengl::t_camera& c = m_render_state.get_camera();
 
-	epiks::t_spring_grid& sg = m_physics_state.get_rope();
-	epiks::t_spring_anchor& sa = sg.get_anchor(0);
+	t_vec3f av = {0.0f, 0.0f, 0.0f};
+
+	av += (c.get_z_vec() * dt * 0.5f * (m_input_state.regular_keys['i'] != 0));
+	av -= (c.get_z_vec() * dt * 0.5f * (m_input_state.regular_keys['k'] != 0));
+	av -= (c.get_x_vec() * dt * 0.5f * (m_input_state.regular_keys['j'] != 0));
+	av += (c.get_x_vec() * dt * 0.5f * (m_input_state.regular_keys['l'] != 0));
+	av += (c.get_y_vec() * dt * 0.5f * (m_input_state.regular_keys['u'] != 0));
+	av -= (c.get_y_vec() * dt * 0.5f * (m_input_state.regular_keys['o'] != 0));
 
-	sa.vel += (c.get_z_vec() * dt * 0.5f * (m_input_state.regular_keys['i'] != 0));
-	sa.vel -= (c.get_z_vec() * dt * 0.5f * (m_input_state.regular_keys['k'] != 0));
-	sa.vel -= (c.get_x_vec() * dt * 0.5f * (m_input_state.regular_keys['j'] != 0));
-	sa.vel += (c.get_x_vec() * dt * 0.5f * (m_input_state.regular_keys['l'] != 0));
-	sa.vel += (c.get_y_vec() * dt * 0.5f * (m_input_state.regular_keys['u'] != 0));
-	sa.vel -= (c.get_y_vec() * dt * 0.5f * (m_input_state.regular_keys['o'] != 0));
+	{
+		std::lock_guard<std::mutex> lock(m_input_mutex);
+		m_anchor_vel_delta += av;
+	}
 
 
 	c.set_pos(c.get_pos() + (c.get_z_vec() * dt * 0.01f * (m_input_state.regular_keys['w'] != 0))); // strafe fwd (-z=fwd)
@@ -41,31 +110,155 @@ void epiks::t_eigen_engine::handle_input(float dt) {
 
 
 void epiks::t_eigen_engine::update_frame() {
-	while (m_wall_clock.get_render_time_ns() >= consts::SIM_STEP_TIME_NS) {
+	uint64_t debt_ns = m_wall_clock.get_sim_debt_ns();
+	uint32_t num_steps = 0;
+
+	// physics thread does its own pacing
+	if (!m_physics_thread.is_running()) {
+		num_steps = m_catchup_policy.calc_num_steps(debt_ns, consts::SIM_STEP_TIME_NS, m_catchup_stats);
+		m_wall_clock.set_sim_debt_ns(debt_ns);
+	}
+
+	for (; num_steps > 0; num_steps--) {
 		// execute one physics-timestep (tick/update)
 		m_update_timer.tick_time();
-		m_physics_state.step(consts::SIM_STEP_TIME_NS * 0.001f * 0.001f * 0.001f);
+		update_tick();
 
-		m_wall_clock.add_render_time_ns(-consts::SIM_STEP_TIME_NS);
+		m_wall_clock.add_sim_debt_ns(-consts::SIM_STEP_TIME_NS);
 		m_wall_clock.add_update_time_ns(m_update_timer.tock_time());
 		m_wall_clock.add_system_time_ns(m_update_timer.tock_time());
 	}
 
 	m_wall_clock.add_update_call();
+
+	// sleep off the rest of the frame, then schedule the next render
+	m_frame_pacer.wait_frame();
+	m_render_state.post_redisplay();
+}
+
+void epiks::t_eigen_engine::update_tick() {
+	EIGENPHYSIKS_PROFILE_ZONE("tick");
+
+	if (m_frame_player.is_open()) {
+		replay_tick();
+		return;
+	}
+	if (m_shm_reader.is_open()) {
+		view_tick();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_input_mutex);
+
+		m_physics_state.get_spring_world().get_grid(0).get_anchor(0).vel += m_anchor_vel_delta;
+		m_anchor_vel_delta = {0.0f, 0.0f, 0.0f};
+	}
+
+	m_physics_state.step(consts::SIM_STEP_TIME_NS * 0.001f * 0.001f * 0.001f);
+
+	m_snapshots.get_back().capture(m_physics_state, ++m_num_ticks);
+	m_snapshots.get_back().publish_time_ns = get_steady_time_ns();
+
+	if (m_frame_recorder.is_recording())
+		m_frame_recorder.record(m_snapshots.get_back());
+	if (m_shm_exporter.is_running())
+		m_shm_exporter.export_frame(m_snapshots.get_back());
+
+	m_snapshots.publish();
+}
+
+void epiks::t_eigen_engine::replay_tick() {
+	epiks::t_state_snapshot& ss = m_snapshots.get_back();
+
+	// loop the recording; a damaged tail also restarts it
+	if (!m_frame_player.read_frame(ss)) {
+		m_frame_player.rewind();
+
+		if (!m_frame_player.read_frame(ss))
+			return;
+	}
+
+	// recorded tick indices restart with the loop, interpolation needs ours
+	ss.tick_index = ++m_num_ticks;
+	ss.publish_time_ns = get_steady_time_ns();
+
+	m_snapshots.publish();
+}
+
+void epiks::t_eigen_engine::view_tick() {
+	epiks::t_state_snapshot& ss = m_snapshots.get_back();
+
+	// exporter has not finished another tick yet (or is gone), keep showing the last one
+	if (!m_shm_reader.read_frame(ss))
+		return;
+
+	// exporter ticks at its own pace, interpolation needs ours
+	ss.tick_index = ++m_num_ticks;
+	ss.publish_time_ns = get_steady_time_ns();
+
+	m_snapshots.publish();
 }
 
 void epiks::t_eigen_engine::render_frame() {
+	EIGENPHYSIKS_PROFILE_ZONE("render_frame");
+
 	handle_input(m_render_timer.tock_time() * 0.001f * 0.001f);
 	m_render_timer.tick_time();
 
+	// keep the outgoing snapshot so there are two ticks to blend between
+	if (m_snapshots.pending()) {
+		m_prev_snapshot.copy_state(m_snapshots.get_front());
+		m_snapshots.consume();
+	}
+
+	m_interp_snapshot.interpolate(m_prev_snapshot, m_snapshots.get_front(), calc_interp_alpha());
+
 	m_render_state.setup_camera();
-	m_render_state.setup_lights(m_physics_state);
-	m_render_state.render_scene(m_physics_state);
-	m_render_state.swap_buffers();
+	m_render_state.setup_lights(m_interp_snapshot);
+	m_render_state.render_scene(m_interp_snapshot);
+
+	{
+		EIGENPHYSIKS_PROFILE_ZONE("render::swap_buffers");
+		m_render_state.swap_buffers();
+	}
 
 	if (m_wall_clock.update(m_render_timer.tock_time())) {
 		m_wall_clock.add_system_time_ns(-consts::WALL_SEC_TIME_NS);
 		m_wall_clock.output_timings(stdout);
+
+		m_frame_pacer.output_stats(stdout);
+
+		if (m_physics_thread.is_running()) {
+			m_physics_thread.get_catchup_stats().output(stdout, "physics_thread");
+		} else {
+			m_catchup_stats.output(stdout, "update_frame");
+		}
 	}
 }
 
+
+float epiks::t_eigen_engine::calc_interp_alpha() const {
+	const epiks::t_state_snapshot& prev = m_prev_snapshot;
+	const epiks::t_state_snapshot& curr = m_snapshots.get_front();
+
+	if (curr.tick_index <= prev.tick_index)
+		return 1.0f;
+
+	// fraction of a tick that has elapsed since the current state, either the
+	// leftover accumulated time (synchronous) or the age of the latest tick
+	float tick_frac = 0.0f;
+
+	if (m_physics_thread.is_running()) {
+		tick_frac = (get_steady_time_ns() - curr.publish_time_ns) / float(consts::SIM_STEP_TIME_NS);
+	} else {
+		tick_frac = m_wall_clock.get_sim_debt_ns() / float(consts::SIM_STEP_TIME_NS);
+	}
+
+	// render one tick in the past so there is always a known state on both
+	// sides; also valid when frames skipped ticks and prev is older than N-1
+	const float num_ticks = curr.tick_index - prev.tick_index;
+	const float rel_ticks = num_ticks - 1.0f + std::min(tick_frac, 1.0f);
+
+	return (rel_ticks / num_ticks);
+}
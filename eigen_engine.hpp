@@ -1,33 +1,67 @@
 #ifndef EIGENPHYSIKS_ENGINE_HDR
 #define EIGENPHYSIKS_ENGINE_HDR
 
+#include <mutex>
+
+#include "catchup_policy.hpp"
+#include "frame_pacer.hpp"
+#include "frame_stream.hpp"
 #include "input_state.hpp"
 #include "physics_state.hpp"
+#include "physics_thread.hpp"
 #include "render_state.hpp"
+#include "shm_export.hpp"
+#include "state_snapshot.hpp"
 #include "system_timer.hpp"
+#include "triple_buffer.hpp"
 #include "wall_clock.hpp"
 
 namespace epiks {
 	struct t_eigen_engine {
 	public:
-		void loop();
-		void init() {
-			m_physics_state.init();
-			m_render_state.init(m_physics_state);
-		}
-		void kill() {
-			m_render_state.kill();
-			m_physics_state.kill();
-		}
+		// if threaded, physics ticks run on their own thread instead of in update_frame
+		void loop(bool threaded);
+		void init(bool threaded);
+		void kill();
+
+		// applies to update_frame and to the physics thread; set before init
+		void set_catchup_policy(const util::t_catchup_policy& p) { m_catchup_policy = p; }
+		// restore physics from this file instead of running the default init
+		void set_checkpoint_file(const char* file_name) { m_checkpoint_file = file_name; }
+		// or build it from a (text or compiled) scene file, see scene_loader.hpp
+		void set_scene_file(const char* file_name) { m_scene_file = file_name; }
+		// write every tick to, or render ticks from (instead of simulating), a recording
+		void set_record_file(const char* file_name) { m_record_file = file_name; }
+		void set_replay_file(const char* file_name) { m_replay_file = file_name; }
+		// publish every tick to, or render ticks from (instead of simulating), a
+		// shared-memory ring; the latter shows a simulation in another process
+		void set_shm_export_name(const char* shm_name) { m_shm_export_name = shm_name; }
+		void set_shm_view_name(const char* shm_name) { m_shm_view_name = shm_name; }
+		void set_physics_rates(const epiks::t_physics_rates& rates) { m_physics_state.set_rates(rates); }
+		// render-rate cap, independent of SIM_STEP_RATE; zero means uncapped
+		void set_max_frame_rate(uint32_t frames_per_sec) { m_frame_pacer.set_max_rate(frames_per_sec); }
 
 		void regular_key_pressed(uint8_t key) {
 			m_input_state.regular_keys[key] = 1;
 
-			switch (key) {
-				case 'p': { m_wall_clock.inv_render_dt_mult(                        ); } break;
-				case 'f': { m_wall_clock.add_render_time_ns(consts::SIM_STEP_TIME_NS); } break;
-				case  27: {                            exit(                       0); } break;
+			if (m_physics_thread.is_running()) {
+				switch (key) {
+					case 'p': { m_physics_thread.toggle_pause   (); } break;
+					case 'f': { m_physics_thread.add_single_step(); } break;
+				}
+			} else {
+				switch (key) {
+					case 'p': { m_wall_clock.inv_sim_dt_mult(                        ); } break;
+					case 'f': { m_wall_clock.add_sim_debt_ns(consts::SIM_STEP_TIME_NS); } break;
+				}
 			}
+
+			// debug-draw layer (goal spheres)
+			if (key == 'g')
+				m_render_state.get_debug_draw().toggle_enabled();
+
+			if (key == 27)
+				exit(0);
 		}
 		void regular_key_released(uint8_t key) { m_input_state.regular_keys[key] = 0; }
 		void special_key_pressed (int32_t key) { m_input_state.special_keys[key] = 1; }
@@ -35,16 +69,56 @@ namespace epiks {
 
 		void handle_input(float dt);
 		void update_frame();
+		void update_tick();
+		void replay_tick();
+		void view_tick();
 		void render_frame();
 
+		float calc_interp_alpha() const;
+
 	private:
 		util::t_system_timer m_render_timer;
 		util::t_system_timer m_update_timer;
 		util::t_wall_clock m_wall_clock;
 		util::t_input_state m_input_state;
+		util::t_frame_pacer m_frame_pacer;
+
+		util::t_catchup_policy m_catchup_policy;
+		util::t_catchup_stats m_catchup_stats;
 
 		epiks::t_physics_state m_physics_state;
 		opengl::t_render_state m_render_state;
+
+		// physics publishes, rendering consumes; never touch m_physics_state
+		// from the render side while the physics thread is running
+		util::t_triple_buffer<epiks::t_state_snapshot> m_snapshots;
+
+		// previously consumed snapshot, blended with the current one into
+		// the interpolated snapshot that is actually rendered
+		epiks::t_state_snapshot m_prev_snapshot;
+		epiks::t_state_snapshot m_interp_snapshot;
+
+		// anchor movement requested by input, applied at the start of a tick
+		std::mutex m_input_mutex;
+		t_vec3f m_anchor_vel_delta = {0.0f, 0.0f, 0.0f};
+
+		uint64_t m_num_ticks = 0;
+
+		const char* m_checkpoint_file = nullptr;
+		const char* m_scene_file = nullptr;
+		const char* m_record_file = nullptr;
+		const char* m_replay_file = nullptr;
+		const char* m_shm_export_name = nullptr;
+		const char* m_shm_view_name = nullptr;
+
+		epiks::t_frame_recorder m_frame_recorder;
+		epiks::t_frame_player m_frame_player;
+
+		epiks::t_shm_exporter m_shm_exporter;
+		epiks::t_shm_reader m_shm_reader;
+
+		// declared last so it is joined before anything it touches is destroyed
+		epiks::t_physics_thread m_physics_thread;
 	};
 };
 
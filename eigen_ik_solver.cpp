@@ -1,10 +1,11 @@
+#include <cmath>
 #include <cstdio>
 #include <limits>
 
-#include <GL/glew.h>
-#include <GL/gl.h>
-
 #include "eigen_ik_solver.hpp"
+#include "frame_arena.hpp"
+#include "profiler.hpp"
+#include "telemetry.hpp"
 
 static constexpr size_t MAX_SOLVE_ITERS = 200;
 static constexpr size_t MAX_ERROR_DECRS = 100;
@@ -12,25 +13,66 @@ static constexpr size_t MAX_ERROR_DECRS = 100;
 static constexpr float MIN_ERROR_BOUND = 0.0050f;
 static constexpr float ROT_DELTA_ANGLE = 0.0005f;
 
-void epiks::t_rb_chain::solve(t_pos3f ws_goal_pos) {
+static const util::t_telem_series TELEM_EARLY_RETURNS("ik::early_returns", util::t_telem_series::KIND_COUNTER);
+static const util::t_telem_series TELEM_MAX_ITERS_REACHED("ik::max_iters_reached", util::t_telem_series::KIND_COUNTER);
+static const util::t_telem_series TELEM_DECRS_EXHAUSTED("ik::error_decrs_exhausted", util::t_telem_series::KIND_COUNTER);
+static const util::t_telem_series TELEM_SOLVE_ITERS("ik::solve_iters", util::t_telem_series::KIND_VALUE);
+static const util::t_telem_series TELEM_TAIL_GOAL_ERROR("ik::tail_goal_error", util::t_telem_series::KIND_VALUE, 1e-6);
+static const util::t_telem_series TELEM_NONFINITE("ik::nonfinite", util::t_telem_series::KIND_COUNTER);
+
+// solver state that can not live in a frame arena; JacobiSVD only accepts
+// (and otherwise copies into) a plain matrix and keeps its own workspace,
+// so both are kept per thread and only reallocated when the chain length
+// changes, which is counted as arena heap traffic
+template<typename t_real>
+struct t_solver_scratch {
+	math::t_matXY<t_real> jac_mat;
+
+	Eigen::JacobiSVD<math::t_matXY<t_real>> svd_mat;
+};
+
+template<typename t_real>
+static t_solver_scratch<t_real>& get_thread_scratch() {
+	static thread_local t_solver_scratch<t_real> scratch;
+	return scratch;
+}
+
+template<typename t_real>
+void epiks::t_basic_rb_chain<t_real>::solve(const t_pos3f& ws_goal_pos_f) {
+	EIGENPHYSIKS_PROFILE_ZONE_VAR(solve_timer, "ik::solve");
+
+	const t_pos3r ws_goal_pos = ws_goal_pos_f.template cast<t_real>();
+
 	// return early if the goal-position did not change
-	if ((ws_goal_pos - m_goal_pos).norm() < MIN_ERROR_BOUND)
+	if ((ws_goal_pos - m_goal_pos).norm() < MIN_ERROR_BOUND) {
+		EIGENPHYSIKS_TELEM_COUNT(TELEM_EARLY_RETURNS, 1);
 		return;
+	}
 
 	// translate world-space goal to object-space
-	t_pos3f goal_pos = get_rel_goal_pos(ws_goal_pos);
-	t_pos3f curr_pos = calc_tail_pos();
+	t_pos3r goal_pos = get_rel_goal_pos(ws_goal_pos);
+	t_pos3r curr_pos = calc_tail_pos();
+
+	// all per-solve temporaries come from (and go back to) this thread's arena
+	util::t_frame_arena& arena = util::t_frame_arena::get_thread_arena();
+	const util::t_frame_arena::t_scope arena_scope(arena);
 
-	t_matX1f delta_mat;
+	const size_t num_dofs = m_pieces.size() * 3;
+
+	Eigen::Map<t_matXYr> inv_jac_mat(arena.alloc_array<t_real>(num_dofs * 3), num_dofs, 3);
+	Eigen::Map<t_matX1r> delta_mat(arena.alloc_array<t_real>(num_dofs), num_dofs);
 
 	// set initial error-bounds
-	// float prev_err = std::numeric_limits<float>::max();
-	float best_error = std::numeric_limits<float>::max();
-	float iter_error = std::numeric_limits<float>::max();
+	// t_real prev_err = std::numeric_limits<t_real>::max();
+	t_real best_error = std::numeric_limits<t_real>::max();
+	t_real iter_error = std::numeric_limits<t_real>::max();
+
+	size_t num_solve_iters = 0;
 
-	for (size_t num_solve_iters = 0; ((iter_error > MIN_ERROR_BOUND) && (num_solve_iters < MAX_SOLVE_ITERS)); num_solve_iters++) {
+	for (; ((iter_error > MIN_ERROR_BOUND) && (num_solve_iters < MAX_SOLVE_ITERS)); num_solve_iters++) {
 		save_iter_transforms();
-		apply_transforms(delta_mat = calc_inv_jacobian(curr_pos) * (goal_pos - curr_pos));
+		calc_inv_jacobian(curr_pos, inv_jac_mat);
+		apply_transforms(delta_mat.noalias() = inv_jac_mat * (goal_pos - curr_pos));
 
 		// revert transforms and bail out when error stops decreasing
 		if (!decr_iter_error(goal_pos, curr_pos, delta_mat, iter_error, best_error)) {
@@ -48,71 +90,92 @@ void epiks::t_rb_chain::solve(t_pos3f ws_goal_pos) {
 	// remember final WS end-effector position; differs from goal if unreachable
 	m_tail_pos = m_base_pos + curr_pos;
 	m_goal_pos = ws_goal_pos;
+
+	solve_timer.set_arg("iters", num_solve_iters);
+
+	if (num_solve_iters == MAX_SOLVE_ITERS)
+		EIGENPHYSIKS_TELEM_COUNT(TELEM_MAX_ITERS_REACHED, 1);
+
+	const t_real tail_goal_error = (m_tail_pos - m_goal_pos).norm();
+
+	// e.g. a NaN goal; the error is NaN as well and add_value drops it
+	if (!std::isfinite(tail_goal_error))
+		EIGENPHYSIKS_TELEM_COUNT(TELEM_NONFINITE, 1);
+
+	EIGENPHYSIKS_TELEM_VALUE(TELEM_SOLVE_ITERS, num_solve_iters);
+	EIGENPHYSIKS_TELEM_VALUE(TELEM_TAIL_GOAL_ERROR, tail_goal_error);
 }
 
-bool epiks::t_rb_chain::decr_iter_error(const t_pos3f& goal_pos, t_pos3f& curr_pos, t_matX1f& delta_mat, float& iter_error, float& best_error) {
+template<typename t_real>
+bool epiks::t_basic_rb_chain<t_real>::decr_iter_error(const t_pos3r& goal_pos, t_pos3r& curr_pos, Eigen::Ref<t_matX1r> delta_mat, t_real& iter_error, t_real& best_error) {
 	// prev_err = iter_error;
 	iter_error = (goal_pos - (curr_pos = calc_tail_pos())).norm();
 
-	for (size_t num_error_decrs = 0; ((iter_error >= best_error) && (num_error_decrs < MAX_ERROR_DECRS)); num_error_decrs++) {
+	size_t num_error_decrs = 0;
+
+	for (; ((iter_error >= best_error) && (num_error_decrs < MAX_ERROR_DECRS)); num_error_decrs++) {
 		// iterated past minimum, cut rotation-angles in half and re-apply them
 		load_iter_transforms();
-		apply_transforms(delta_mat *= 0.5f);
+		apply_transforms(delta_mat *= t_real(0.5));
 
 		// prev_err = iter_error;
 		iter_error = (goal_pos - (curr_pos = calc_tail_pos())).norm();
 	}
 
+	// step size was halved to nothing without getting any closer
+	if (num_error_decrs == MAX_ERROR_DECRS)
+		EIGENPHYSIKS_TELEM_COUNT(TELEM_DECRS_EXHAUSTED, 1);
+
 	return (iter_error < best_error);
 }
 
 
-t_matXYf epiks::t_rb_chain::calc_jacobian(const t_pos3f& chain_end_pos) {
-	assert(chain_end_pos == calc_tail_pos());
+template<typename t_real>
+void epiks::t_basic_rb_chain<t_real>::calc_inv_jacobian(const t_pos3r& chain_end_pos, Eigen::Ref<t_matXYr> inv_jac_mat) {
+	t_solver_scratch<t_real>& scratch = get_thread_scratch<t_real>();
 
-	// create the Jacobian matrix; transposed for easier indexing
-	t_matXYf chain_jac_mat(3 * m_pieces.size(), 3);
-	t_mat33f piece_jac_mat;
+	calc_jacobian(chain_end_pos, scratch.jac_mat);
 
-	for (size_t i = 0; i < m_pieces.size(); i++) {
-		#if 0
-		const t_pos3f& piece_end_pos = m_pieces[i].get_tail_pos();
-		const t_rot4f& piece_end_rot = m_pieces[i].get_transform();
-		#endif
+	EIGENPHYSIKS_PROFILE_ZONE("ik::pseudo_inverse");
+	math::calc_pseudo_inverse(scratch.jac_mat, scratch.svd_mat, inv_jac_mat, util::t_frame_arena::get_thread_arena());
+}
 
-		piece_jac_mat = calc_piece_jacobian(m_pieces[i], chain_end_pos);
+template<typename t_real>
+void epiks::t_basic_rb_chain<t_real>::calc_jacobian(const t_pos3r& chain_end_pos, t_matXYr& jac_mat) {
+	EIGENPHYSIKS_PROFILE_ZONE("ik::jacobian");
+	assert(chain_end_pos == calc_tail_pos());
 
-		chain_jac_mat(i * 3 + 0, 0) = piece_jac_mat(0, 0);
-		chain_jac_mat(i * 3 + 0, 1) = piece_jac_mat(0, 1);
-		chain_jac_mat(i * 3 + 0, 2) = piece_jac_mat(0, 2);
+	if (jac_mat.rows() != 3 || size_t(jac_mat.cols()) != (3 * m_pieces.size())) {
+		jac_mat.resize(3, 3 * m_pieces.size());
+		util::t_frame_arena::add_heap_allocs(1);
+	}
 
-		chain_jac_mat(i * 3 + 1, 0) = piece_jac_mat(1, 0);
-		chain_jac_mat(i * 3 + 1, 1) = piece_jac_mat(1, 1);
-		chain_jac_mat(i * 3 + 1, 2) = piece_jac_mat(1, 2);
+	// fill the Jacobian matrix; column i*3+r holds piece i's r-axis derivatives
+	t_mat33r piece_jac_mat;
 
-		chain_jac_mat(i * 3 + 2, 0) = piece_jac_mat(2, 0);
-		chain_jac_mat(i * 3 + 2, 1) = piece_jac_mat(2, 1);
-		chain_jac_mat(i * 3 + 2, 2) = piece_jac_mat(2, 2);
-	}
+	for (size_t i = 0; i < m_pieces.size(); i++) {
+		piece_jac_mat = calc_piece_jacobian(m_pieces[i], chain_end_pos);
 
-	return (chain_jac_mat.transpose());
+		jac_mat.template middleCols<3>(i * 3) = piece_jac_mat.transpose();
+	}
 }
 
-t_mat33f epiks::t_rb_chain::calc_piece_jacobian(t_rb_piece& piece, const t_pos3f& curr_end_pos) {
-	t_mat33f piece_jac_mat;
+template<typename t_real>
+typename epiks::t_basic_rb_chain<t_real>::t_mat33r epiks::t_basic_rb_chain<t_real>::calc_piece_jacobian(t_piece& piece, const t_pos3r& curr_end_pos) {
+	t_mat33r piece_jac_mat;
 
 	for (size_t axis_idx = consts::AXIS_IDX_X; axis_idx <= consts::AXIS_IDX_Z; axis_idx++) {
 		// forward and inverse differential rotations
-		const t_rot4f fwd_diff_rot = t_rot4f(ROT_DELTA_ANGLE, piece.get_axis(axis_idx));
-		const t_rot4f inv_diff_rot = fwd_diff_rot.inverse();
+		const t_rot4r fwd_diff_rot = t_rot4r(ROT_DELTA_ANGLE, piece.get_axis(axis_idx));
+		const t_rot4r inv_diff_rot = fwd_diff_rot.inverse();
 
 		// find out the delta-transform's influence on the chain end-effector
 		// (could also start from piece_end_rot to run in half-quadratic time)
 		// TODO: per-axis angular constraints to emulate other types of joints, minimize SSE
 		piece.apply_transform(fwd_diff_rot);
 
-		const t_pos3f next_end_pos = calc_tail_pos();
-		const t_vec3f diff_end_pos = (next_end_pos - curr_end_pos) / fwd_diff_rot.angle();
+		const t_pos3r next_end_pos = calc_tail_pos();
+		const t_vec3r diff_end_pos = (next_end_pos - curr_end_pos) / fwd_diff_rot.angle();
 
 		// restore current unperturbed transform for this piece
 		piece.apply_transform(inv_diff_rot);
@@ -128,8 +191,9 @@ t_mat33f epiks::t_rb_chain::calc_piece_jacobian(t_rb_piece& piece, const t_pos3f
 
 
 
-t_pos3f epiks::t_rb_chain::calc_tail_pos(size_t min_piece_idx, size_t max_piece_idx) const {
-	t_pos3f pos = {0.0f, 0.0f, 0.0f};
+template<typename t_real>
+typename epiks::t_basic_rb_chain<t_real>::t_pos3r epiks::t_basic_rb_chain<t_real>::calc_tail_pos(size_t min_piece_idx, size_t max_piece_idx) const {
+	t_pos3r pos = {t_real(0), t_real(0), t_real(0)};
 
 	if (max_piece_idx == size_t(-1))
 		max_piece_idx = m_pieces.size() - 1;
@@ -141,3 +205,6 @@ t_pos3f epiks::t_rb_chain::calc_tail_pos(size_t min_piece_idx, size_t max_piece_
 	return pos;
 }
 
+
+template class epiks::t_basic_rb_chain<float>;
+template class epiks::t_basic_rb_chain<double>;
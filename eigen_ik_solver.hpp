@@ -9,31 +9,42 @@
 #include "world_consts.hpp"
 
 namespace epiks {
-	class t_rb_piece {
+	// pieces and chains compute in t_real; their world-facing interface (goal,
+	// base and tail positions, piece transforms) is float so the rest of the
+	// engine does not care which precision a chain was instantiated with
+	template<typename t_real>
+	class t_basic_rb_piece {
 	public:
-		t_rb_piece(float length = 0.0f) {
-			m_curr_trans = t_rot4f::Identity();
-			m_iter_trans = t_rot4f::Identity();
-			m_best_trans = t_rot4f::Identity();
+		typedef math::t_pos3<t_real> t_pos3r;
+		typedef math::t_vec3<t_real> t_vec3r;
+		typedef math::t_rot4<t_real> t_rot4r;
+
+	public:
+		t_basic_rb_piece(float length = 0.0f) {
+			m_curr_trans = t_rot4r::Identity();
+			m_iter_trans = t_rot4r::Identity();
+			m_best_trans = t_rot4r::Identity();
 
 			m_length = length;
 		}
 
 		// tail is base of next segment; same as returning base + zaxis * length
-		// t_pos3f get_base_pos() const { return (transform_pos(t_pos3f(0.0f, 0.0f, m_length * 0.0f))); }
-		t_pos3f get_tail_pos() const { return (transform_pos(t_pos3f(0.0f, 0.0f, m_length * 1.0f))); }
-		t_pos3f transform_pos(const t_pos3f& pos) const { return (m_curr_trans * pos); }
+		// t_pos3r get_base_pos() const { return (transform_pos(t_pos3r(0.0, 0.0, m_length * 0.0))); }
+		t_pos3r get_tail_pos() const { return (transform_pos(t_pos3r(t_real(0), t_real(0), m_length * t_real(1)))); }
+		t_pos3r transform_pos(const t_pos3r& pos) const { return (m_curr_trans * pos); }
 
-		t_rot4f get_transform() const { return m_curr_trans; }
-		t_rot4f chain_transform(const t_rot4f& trans) const { return (t_rot4f(trans * m_curr_trans)); }
+		t_rot4f get_transform() const { return (m_curr_trans.template cast<float>()); }
+		t_rot4f get_iter_transform() const { return (m_iter_trans.template cast<float>()); }
+		t_rot4f get_best_transform() const { return (m_best_trans.template cast<float>()); }
+		t_rot4r chain_transform(const t_rot4r& trans) const { return (t_rot4r(trans * m_curr_trans)); }
 
-		t_vec3f get_axis(size_t idx) const { return (m_curr_trans * consts::WORLD_AXES[idx]); }
-		t_vec3f get_x_axis() const { return (get_axis(consts::AXIS_IDX_X)); }
-		t_vec3f get_y_axis() const { return (get_axis(consts::AXIS_IDX_Y)); }
-		t_vec3f get_z_axis() const { return (get_axis(consts::AXIS_IDX_Z)); }
+		t_vec3r get_axis(size_t idx) const { return (m_curr_trans * consts::WORLD_AXES[idx].template cast<t_real>()); }
+		t_vec3r get_x_axis() const { return (get_axis(consts::AXIS_IDX_X)); }
+		t_vec3r get_y_axis() const { return (get_axis(consts::AXIS_IDX_Y)); }
+		t_vec3r get_z_axis() const { return (get_axis(consts::AXIS_IDX_Z)); }
 
 		float get_length() const { return m_length; }
-		float get_angle() const { return (m_curr_trans.angle()); }
+		t_real get_angle() const { return (m_curr_trans.angle()); }
 
 
 		void save_iter_transform() { m_iter_trans = m_curr_trans; }
@@ -42,10 +53,17 @@ namespace epiks {
 		void save_best_transform() { m_best_trans = m_curr_trans; }
 		void load_best_transform() { m_curr_trans = m_best_trans; }
 
+		// restores all solver state, e.g. from a checkpoint
+		void set_transforms(const t_rot4f& curr, const t_rot4f& iter, const t_rot4f& best) {
+			m_curr_trans = curr.template cast<t_real>();
+			m_iter_trans = iter.template cast<t_real>();
+			m_best_trans = best.template cast<t_real>();
+		}
+
 
-		void apply_transform(float angle, const t_vec3f& axis) { apply_transform(t_rot4f(angle, axis)); }
-		void apply_transform(const t_rot4f& trans) { m_curr_trans = chain_transform(trans); }
-		void apply_transform(const t_vec3f& angles) {
+		void apply_transform(t_real angle, const t_vec3r& axis) { apply_transform(t_rot4r(angle, axis)); }
+		void apply_transform(const t_rot4r& trans) { m_curr_trans = chain_transform(trans); }
+		void apply_transform(const t_vec3r& angles) {
 			apply_transform(angles.x(), get_x_axis()); // pitch
 			apply_transform(angles.y(), get_y_axis()); //   yaw
 			apply_transform(angles.z(), get_z_axis()); //  roll
@@ -53,17 +71,29 @@ namespace epiks {
 
 	private:
 		// note: rotations are NOT relative to the previous piece
-		t_rot4f m_curr_trans;
-		t_rot4f m_iter_trans;
-		t_rot4f m_best_trans;
+		t_rot4r m_curr_trans;
+		t_rot4r m_iter_trans;
+		t_rot4r m_best_trans;
 
 		float m_length;
 	};
 
 
-	class t_rb_chain {
+	// member functions are explicitly instantiated for float and double
+	template<typename t_real>
+	class t_basic_rb_chain {
+	public:
+		typedef math::t_pos3<t_real> t_pos3r;
+		typedef math::t_vec3<t_real> t_vec3r;
+		typedef math::t_rot4<t_real> t_rot4r;
+		typedef math::t_mat33<t_real> t_mat33r;
+		typedef math::t_matXY<t_real> t_matXYr;
+		typedef math::t_matX1<t_real> t_matX1r;
+
+		typedef t_basic_rb_piece<t_real> t_piece;
+
 	public:
-		t_rb_chain() {
+		t_basic_rb_chain() {
 			set_base_pos({0.0f, 0.0f, 0.0f});
 			set_goal_pos({0.0f, 0.0f, 0.0f});
 
@@ -73,61 +103,67 @@ namespace epiks {
 
 		size_t get_num_pieces() const { return (m_pieces.size()); }
 
-		const std::vector<t_rb_piece>& get_pieces() const { return m_pieces; }
-		      std::vector<t_rb_piece>& get_pieces()       { return m_pieces; }
+		const std::vector<t_piece>& get_pieces() const { return m_pieces; }
+		      std::vector<t_piece>& get_pieces()       { return m_pieces; }
 
-		const t_rb_piece& get_piece(size_t i) const { return m_pieces[i]; }
-		      t_rb_piece& get_piece(size_t i)       { return m_pieces[i]; }
+		const t_piece& get_piece(size_t i) const { return m_pieces[i]; }
+		      t_piece& get_piece(size_t i)       { return m_pieces[i]; }
 
 		// all in world-space
-		t_pos3f get_base_pos() const { return m_base_pos; }
-		t_pos3f get_goal_pos() const { return m_goal_pos; }
-		t_pos3f get_tail_pos() const { return m_tail_pos; }
+		t_pos3f get_base_pos() const { return (m_base_pos.template cast<float>()); }
+		t_pos3f get_goal_pos() const { return (m_goal_pos.template cast<float>()); }
+		t_pos3f get_tail_pos() const { return (m_tail_pos.template cast<float>()); }
 
-		void set_base_pos(const t_pos3f& ws_base_pos) { m_base_pos = ws_base_pos; }
-		void set_goal_pos(const t_pos3f& ws_goal_pos) { m_goal_pos = ws_goal_pos; }
+		void set_base_pos(const t_pos3f& ws_base_pos) { m_base_pos = ws_base_pos.template cast<t_real>(); }
+		void set_goal_pos(const t_pos3f& ws_goal_pos) { m_goal_pos = ws_goal_pos.template cast<t_real>(); }
+		void set_tail_pos(const t_pos3f& ws_tail_pos) { m_tail_pos = ws_tail_pos.template cast<t_real>(); }
 
 		void add_piece(float length) { m_pieces.emplace_back(length); }
 		void pop_piece() { m_pieces.pop_back(); }
 
-		void solve(t_pos3f ws_goal_pos);
+		void solve(const t_pos3f& ws_goal_pos);
 
-	private:
-		t_mat33f calc_piece_jacobian(t_rb_piece& piece, const t_pos3f& curr_end_pos);
-		t_matXYf calc_jacobian(const t_pos3f& chain_end_pos);
-		t_matXYf calc_inv_jacobian(const t_pos3f& chain_end_pos) { return (math::calc_pseudo_inverse(calc_jacobian(chain_end_pos))); }
-
-		t_pos3f get_rel_goal_pos(const t_pos3f& goal_pos) { return (get_rel_goal_vec(goal_pos) * get_rel_goal_dist(goal_pos)); }
-		t_pos3f get_rel_goal_vec(const t_pos3f& goal_pos) { return ((goal_pos - m_base_pos).normalized()); }
+		// public so they can be benchmarked in isolation; chain_end_pos is
+		// the object-space end-effector position (see calc_tail_pos)
+		// jac_mat is resized to 3 x 3N only if its size differs, and inv_jac_mat
+		// must already be 3N x 3 (N = number of pieces)
+		void calc_jacobian(const t_pos3r& chain_end_pos, t_matXYr& jac_mat);
+		void calc_inv_jacobian(const t_pos3r& chain_end_pos, Eigen::Ref<t_matXYr> inv_jac_mat);
 
 		// computes the end-effector position in object-space
-		t_pos3f calc_tail_pos(size_t min_piece_idx = 0, size_t max_piece_idx = size_t(-1)) const;
+		t_pos3r calc_tail_pos(size_t min_piece_idx = 0, size_t max_piece_idx = size_t(-1)) const;
+
+	private:
+		t_mat33r calc_piece_jacobian(t_piece& piece, const t_pos3r& curr_end_pos);
 
+		t_pos3r get_rel_goal_pos(const t_pos3r& goal_pos) { return (get_rel_goal_vec(goal_pos) * get_rel_goal_dist(goal_pos)); }
+		t_pos3r get_rel_goal_vec(const t_pos3r& goal_pos) { return ((goal_pos - m_base_pos).normalized()); }
 
-		void load_best_transforms() { for (t_rb_piece& j: m_pieces) { j.load_best_transform(); } }
-		void save_best_transforms() { for (t_rb_piece& j: m_pieces) { j.save_best_transform(); } }
-		void load_iter_transforms() { for (t_rb_piece& j: m_pieces) { j.load_iter_transform(); } }
-		void save_iter_transforms() { for (t_rb_piece& j: m_pieces) { j.save_iter_transform(); } }
-		void apply_transforms(const t_matX1f& mat) {
+
+		void load_best_transforms() { for (t_piece& j: m_pieces) { j.load_best_transform(); } }
+		void save_best_transforms() { for (t_piece& j: m_pieces) { j.save_best_transform(); } }
+		void load_iter_transforms() { for (t_piece& j: m_pieces) { j.load_iter_transform(); } }
+		void save_iter_transforms() { for (t_piece& j: m_pieces) { j.save_iter_transform(); } }
+		void apply_transforms(const Eigen::Ref<const t_matX1r>& mat) {
 			for (size_t i = 0; i < m_pieces.size(); i++) {
-				m_pieces[i].apply_transform(t_vec3f(mat[i * 3 + 0], mat[i * 3 + 1], mat[i * 3 + 2]));
+				m_pieces[i].apply_transform(t_vec3r(mat[i * 3 + 0], mat[i * 3 + 1], mat[i * 3 + 2]));
 			}
 		}
 
 
-		bool decr_iter_error(const t_pos3f& goal_pos, t_pos3f& curr_pos, t_matX1f& delta_mat, float& iter_error, float& best_error);
+		bool decr_iter_error(const t_pos3r& goal_pos, t_pos3r& curr_pos, Eigen::Ref<t_matX1r> delta_mat, t_real& iter_error, t_real& best_error);
 
-		float get_rel_goal_dist(const t_pos3f& goal_pos) const { return (std::min((goal_pos - m_base_pos).norm(), get_max_length())); }
-		float get_max_length() const {
-			float len = 0.0f;
-			for (const t_rb_piece& j: m_pieces) {
+		t_real get_rel_goal_dist(const t_pos3r& goal_pos) const { return (std::min((goal_pos - m_base_pos).norm(), get_max_length())); }
+		t_real get_max_length() const {
+			t_real len = t_real(0);
+			for (const t_piece& j: m_pieces) {
 				len += j.get_length();
 			}
 			return len;
 		}
-		float get_sum_squared_angles() const {
-			float sum = 0.0f;
-			for (const t_rb_piece& j: m_pieces) {
+		t_real get_sum_squared_angles() const {
+			t_real sum = t_real(0);
+			for (const t_piece& j: m_pieces) {
 				sum += (j.get_angle() * j.get_angle());
 			}
 			return sum;
@@ -135,13 +171,18 @@ namespace epiks {
 
 	private:
 		// world-space {chain anchor,solved end-effector,previous goal} positions
-		t_pos3f m_base_pos;
-		t_pos3f m_goal_pos;
-		t_pos3f m_tail_pos;
+		t_pos3r m_base_pos = {t_real(0), t_real(0), t_real(0)};
+		t_pos3r m_goal_pos = {t_real(0), t_real(0), t_real(0)};
+		t_pos3r m_tail_pos = {t_real(0), t_real(0), t_real(0)};
 
 		// rigid-body segments making up the kinematic chain
-		std::vector<t_rb_piece> m_pieces;
+		std::vector<t_piece> m_pieces;
 	};
+
+
+	// the precision the engine itself runs chains at (see eigen_types.hpp)
+	typedef t_basic_rb_piece<t_solver_real> t_rb_piece;
+	typedef t_basic_rb_chain<t_solver_real> t_rb_chain;
 };
 
 #endif
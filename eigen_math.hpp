@@ -2,25 +2,21 @@
 #define EIGENPHYSIKS_MATH_HDR
 
 #include "eigen_types.hpp"
+#include "frame_arena.hpp"
 
 namespace math {
-	template<typename t_matrix>
-	static t_matrix calc_pseudo_inverse(const t_matrix& a, double epsilon = std::numeric_limits<double>::epsilon()) {
+	// default singular-value cutoff; this is double's epsilon for every scalar
+	// type (i.e. practically nothing is truncated), which is what the solver
+	// has always used and what its float results are tuned against
+	template<typename t_real>
+	static t_real get_pseudo_inverse_epsilon() { return (t_real(std::numeric_limits<double>::epsilon())); }
+
+	// works for any scalar type; the tolerance is computed in t_matrix's own
+	// scalar rather than in double
+	template<typename t_matrix, typename t_real = typename t_matrix::Scalar>
+	static t_matrix calc_pseudo_inverse(const t_matrix& a, t_real epsilon = get_pseudo_inverse_epsilon<t_real>()) {
 		typedef Eigen::JacobiSVD<t_matrix> t_svd_matrix;
-		typedef Eigen::Matrix<float, -1, 1> t_sin_val_matrix;
-		typedef Eigen::ArrayWrapper<const t_sin_val_matrix> t_sin_val_array;
-
-		typedef Eigen::internal::scalar_abs_op<float> t_scalar_abs_op;
-		typedef Eigen::internal::scalar_inverse_op<float> t_scalar_inv_op;
-		typedef Eigen::internal::scalar_constant_op<float> t_scalar_const_op;
-		typedef std::binder2nd<std::greater<float> > t_scalar_gt_op; // Eigen has no internal::scalar_gt_op
-
-		typedef Eigen::CwiseUnaryOp<t_scalar_abs_op, const t_sin_val_array> t_abs_val_array;
-		typedef Eigen::CwiseUnaryOp<t_scalar_inv_op, const t_sin_val_array> t_inv_val_array;
-		typedef Eigen::CwiseUnaryOp<t_scalar_gt_op , const t_abs_val_array> t_cmp_val_array; // 1 or 0
-
-		typedef Eigen::CwiseNullaryOp<t_scalar_const_op, const t_inv_val_array> t_nul_val_array;
-		typedef Eigen::Select<t_cmp_val_array, t_inv_val_array, t_nul_val_array> t_select;
+		typedef Eigen::Matrix<t_real, -1, 1> t_sin_val_matrix;
 
 		const t_svd_matrix svd_matrix(a, Eigen::ComputeThinU | Eigen::ComputeThinV);
 
@@ -29,22 +25,50 @@ namespace math {
 
 		// diagonal matrix; singular values are returned in decreasing order of magnitude
 		const t_sin_val_matrix& svals_mat = svd_matrix.singularValues();
-		const t_sin_val_array& svals_arr = svals_mat.array();
 
-		const t_inv_val_array& svals_inv_arr = svals_arr.inverse();
-		const t_abs_val_array& svals_abs_arr = svals_arr.abs();
-		const t_cmp_val_array& svals_cmp_arr = (svals_abs_arr > (epsilon * std::max(a.cols(), a.rows()) * svals_abs_arr(0)));
-		const t_nul_val_array  const_nul_arr = t_nul_val_array(svals_arr.rows(), svals_arr.cols(), 0.0);
+		const t_real svals_tol = epsilon * std::max(a.cols(), a.rows()) * std::abs(svals_mat(0));
 
 		// compute the inverses of all sv's whose absolute value exceeds epsilon
-		// const t_select& sel_arr = svals_cmp_arr.select(svals_inv_arr, 0.0);
-		const t_select& sel_arr = svals_cmp_arr.select(svals_inv_arr, const_nul_arr);
-		const t_matrix& sel_mat = sel_arr.matrix();
+		const t_sin_val_matrix sel_mat = (svals_mat.array().abs() > svals_tol).select(svals_mat.array().inverse(), t_real(0)).matrix();
 
 		// Moore-Penrose pseudo-inverse
 		return (v_matrix * sel_mat.asDiagonal() * u_matrix.adjoint());
 	}
 
+	// in-place variant for per-tick callers; svd is reused across calls (it
+	// only reallocates when the dimensions of a change) and every temporary
+	// is taken from arena, so no heap memory is touched in the steady state
+	// result must be a.cols() x a.rows()
+	template<typename t_matrix, typename t_result, typename t_real = typename t_matrix::Scalar>
+	static void calc_pseudo_inverse(
+		const t_matrix& a,
+		Eigen::JacobiSVD<t_matrix>& svd_matrix,
+		t_result& result,
+		util::t_frame_arena& arena,
+		t_real epsilon = get_pseudo_inverse_epsilon<t_real>()
+	) {
+		typedef Eigen::Map<Eigen::Matrix<t_real, -1, 1>> t_sin_val_map;
+		typedef Eigen::Map<Eigen::Matrix<t_real, -1, -1>> t_prod_map;
+
+		const util::t_frame_arena::t_scope scope(arena);
+
+		svd_matrix.compute(a, Eigen::ComputeThinU | Eigen::ComputeThinV);
+
+		const auto& v_matrix = svd_matrix.matrixV();
+		const auto& u_matrix = svd_matrix.matrixU();
+		const auto& svals_mat = svd_matrix.singularValues();
+
+		const t_real svals_tol = epsilon * std::max(a.cols(), a.rows()) * std::abs(svals_mat(0));
+
+		t_sin_val_map sel_mat(arena.alloc_array<t_real>(svals_mat.size()), svals_mat.size());
+		t_prod_map vs_matrix(arena.alloc_array<t_real>(v_matrix.rows() * v_matrix.cols()), v_matrix.rows(), v_matrix.cols());
+
+		sel_mat = (svals_mat.array().abs() > svals_tol).select(svals_mat.array().inverse(), t_real(0)).matrix();
+
+		// same products as above, split so neither needs an Eigen temporary
+		vs_matrix.noalias() = v_matrix * sel_mat.asDiagonal();
+		result.noalias() = vs_matrix * u_matrix.adjoint();
+	}
 
 	// this surpresses "defined but not used" warnings
 	template<typename t_dummy = void>
@@ -77,10 +101,51 @@ namespace math {
 		return m;
 	}
 
+	template<typename t_dummy = void>
+	static t_rot4f slerp_rotation(const t_rot4f& a, const t_rot4f& b, float alpha) {
+		// shortest-arc interpolation; AngleAxis has no slerp of its own
+		return (t_rot4f(Eigen::Quaternionf(a).slerp(alpha, Eigen::Quaternionf(b))));
+	}
+
 	template<typename t_dummy = void>
 	static t_mat44f compose_transform_matrix(const t_xform& xform) {
 		return (compose_transform_matrix(xform.pos, xform.rot));
 	}
+
+
+	// column-major, as gluPerspective would build it; fov_y in degrees
+	template<typename t_dummy = void>
+	static t_mat44f calc_perspective_matrix(float fov_y, float aspect, float z_near, float z_far) {
+		const float f = 1.0f / std::tan(fov_y * 0.5f * float(M_PI / 180.0));
+
+		t_mat44f m = t_mat44f::Zero();
+
+		m(0, 0) = f / aspect;
+		m(1, 1) = f;
+		m(2, 2) = (z_far + z_near) / (z_near - z_far);
+		m(2, 3) = (2.0f * z_far * z_near) / (z_near - z_far);
+		m(3, 2) = -1.0f;
+		return m;
+	}
+
+	// column-major, as gluLookAt would build it
+	template<typename t_dummy = void>
+	static t_mat44f calc_look_at_matrix(const t_pos3f& pos, const t_pos3f& tgt, const t_vec3f& up) {
+		const t_vec3f f = (tgt - pos).normalized();
+		const t_vec3f s = (f.cross(up)).normalized();
+		const t_vec3f u = s.cross(f);
+
+		t_mat44f m = t_mat44f::Identity();
+
+		m.block<1, 3>(0, 0) =  s.transpose();
+		m.block<1, 3>(1, 0) =  u.transpose();
+		m.block<1, 3>(2, 0) = -f.transpose();
+
+		m(0, 3) = -s.dot(pos);
+		m(1, 3) = -u.dot(pos);
+		m(2, 3) =  f.dot(pos);
+		return m;
+	}
 };
 
 #endif
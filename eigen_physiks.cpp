@@ -1,8 +1,14 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
 #include <GL/glew.h>
 #include <GL/gl.h>
 #include <GL/freeglut.h>
 
 #include "eigen_engine.hpp"
+#include "telemetry.hpp"
+#include "trace_writer.hpp"
 
 static epiks::t_eigen_engine g_engine;
 
@@ -38,8 +44,65 @@ static void init_glut(int argc, char** argv) {
 }
 
 int main(int argc, char** argv) {
+	// physics runs on its own thread unless asked to share the render thread
+	bool threaded = true;
+
+	util::t_catchup_policy catchup_policy;
+	epiks::t_physics_rates physics_rates;
+
+	// render-rate cap; 0 renders as fast as the driver (or vsync) allows
+	uint32_t max_frame_rate = 60;
+
+	for (int i = 1; i < argc; i++) {
+		threaded &= (std::strcmp(argv[i], "--sync-physics") != 0);
+
+		// at most N ticks per frame (or physics wake-up); excess debt is dropped or carried
+		if (std::strcmp(argv[i], "--max-catchup") == 0 && (i + 1) < argc)
+			catchup_policy.max_steps = std::max(std::atoi(argv[++i]), 1);
+		if (std::strcmp(argv[i], "--max-fps") == 0 && (i + 1) < argc)
+			max_frame_rate = std::max(std::atoi(argv[++i]), 0);
+		if (std::strcmp(argv[i], "--catchup-drop") == 0)
+			catchup_policy.mode = util::t_catchup_policy::MODE_DROP;
+
+		// per-subsystem rates (Hz); chains may run slower than the springs
+		if (std::strcmp(argv[i], "--chain-rate") == 0 && (i + 1) < argc)
+			physics_rates.chain_rate_hz = std::max(std::atoi(argv[++i]), 1);
+		if (std::strcmp(argv[i], "--spring-rate") == 0 && (i + 1) < argc)
+			physics_rates.spring_rate_hz = std::max(std::atoi(argv[++i]), 1);
+		if (std::strcmp(argv[i], "--lerp-pulls") == 0)
+			physics_rates.lerp_pulls = true;
+
+		if (std::strcmp(argv[i], "--load-checkpoint") == 0 && (i + 1) < argc)
+			g_engine.set_checkpoint_file(argv[++i]);
+		if (std::strcmp(argv[i], "--scene") == 0 && (i + 1) < argc)
+			g_engine.set_scene_file(argv[++i]);
+		if (std::strcmp(argv[i], "--record") == 0 && (i + 1) < argc)
+			g_engine.set_record_file(argv[++i]);
+		if (std::strcmp(argv[i], "--replay") == 0 && (i + 1) < argc)
+			g_engine.set_replay_file(argv[++i]);
+		// --shm-export <name> publishes ticks to, --shm-view <name> renders
+		// them from, a shared-memory ring (see shm_export.hpp)
+		if (std::strcmp(argv[i], "--shm-export") == 0 && (i + 1) < argc)
+			g_engine.set_shm_export_name(argv[++i]);
+		if (std::strcmp(argv[i], "--shm-view") == 0 && (i + 1) < argc)
+			g_engine.set_shm_view_name(argv[++i]);
+
+		// --trace <file> records a Chrome trace-event timeline
+		if (std::strcmp(argv[i], "--trace") == 0 && (i + 1) < argc)
+			util::t_trace_writer::get_instance().start(argv[++i]);
+		// --telemetry <file> also dumps the per-second counters as CSV (or
+		// JSON lines if <file> ends in .json), see telemetry.hpp
+		if (std::strcmp(argv[i], "--telemetry") == 0 && (i + 1) < argc)
+			util::t_telemetry::get_instance().start_dump(argv[++i]);
+	}
+
 	init_glut(argc, argv);
-	g_engine.loop();
+	g_engine.set_catchup_policy(catchup_policy);
+	g_engine.set_physics_rates(physics_rates);
+	g_engine.set_max_frame_rate(max_frame_rate);
+	g_engine.loop(threaded);
+	util::t_trace_writer::get_instance().stop();
+	util::t_telemetry::get_instance().stop_dump();
     return 0;
 }
 
@@ -7,10 +7,36 @@
 #include <Eigen/Dense>
 
 namespace math {
+	// scalar-generic forms of the typedefs below, for code templated on precision
+	template<typename t_real> using t_pos3 = Eigen::Matrix<t_real, 3, 1>;
+	template<typename t_real> using t_vec3 = Eigen::Matrix<t_real, 3, 1>;
+	template<typename t_real> using t_rot4 = Eigen::AngleAxis<t_real>;
+
+	template<typename t_real> using t_mat33 = Eigen::Matrix<t_real,              3,              3>;
+	template<typename t_real> using t_matXY = Eigen::Matrix<t_real, Eigen::Dynamic, Eigen::Dynamic>;
+	template<typename t_real> using t_matX1 = Eigen::Matrix<t_real, Eigen::Dynamic,              1>;
+
+	// compile-time precision selection; state storage (and everything the
+	// renderers, snapshots and checkpoints see) is always float, these only
+	// pick the scalar the IK solver works in and the one spring forces are
+	// accumulated and integrated in (float storage, double accumulation)
+	#ifdef EIGENPHYSIKS_DOUBLE_SOLVER
+	typedef double t_solver_real;
+	#else
+	typedef float t_solver_real;
+	#endif
+
+	#ifdef EIGENPHYSIKS_DOUBLE_ACCUM
+	typedef double t_accum_real;
+	#else
+	typedef float t_accum_real;
+	#endif
+
 	// NB: these do *not* zero-initialize on construction
 	typedef Eigen::Vector3f t_pos3f;
 	typedef Eigen::Vector3f t_vec3f;
 	typedef Eigen::AngleAxisf t_rot4f;
+	typedef Eigen::Quaternionf t_quat4f;
 
 	typedef Eigen::Matrix<float,              1,              3> t_mat13f;
 	typedef Eigen::Matrix<float,              3,              3> t_mat33f;
@@ -25,9 +51,20 @@ namespace math {
 	};
 };
 
+using math::t_pos3;
+using math::t_vec3;
+using math::t_rot4;
+using math::t_mat33;
+using math::t_matXY;
+using math::t_matX1;
+
+using math::t_solver_real;
+using math::t_accum_real;
+
 using math::t_pos3f;
 using math::t_vec3f;
 using math::t_rot4f;
+using math::t_quat4f;
 
 using math::t_mat13f;
 using math::t_mat33f;
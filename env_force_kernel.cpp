@@ -0,0 +1,125 @@
+#include "env_force_kernel.hpp"
+
+// the loop below is written to be auto-vectorized for each target; the
+// masks only if-convert (and so vectorize below AVX-512) at O3, and FMA
+// contraction is disabled so every variant rounds exactly like the scalar
+// code (AVX-512 implies FMA)
+#pragma GCC optimize("O3", "fp-contract=off")
+
+static_assert(sizeof(t_vec3f) == (sizeof(float) * 3), "t_vec3f must be a packed xyz triple");
+static_assert(sizeof(t_vec3<t_accum_real>) == (sizeof(t_accum_real) * 3), "t_vec3<t_accum_real> must be a packed xyz triple");
+
+template<typename t_real>
+static inline __attribute__((always_inline)) void calc_env_forces(
+	t_real* __restrict forces,
+	const float* __restrict positions,
+	const float* __restrict velocities,
+	const float* __restrict masses,
+	size_t num_objects,
+	const t_vec3f& gravity_acc,
+	const epiks::t_world_params& params
+) {
+	const t_real gx = gravity_acc.x();
+	const t_real gy = gravity_acc.y();
+	const t_real gz = gravity_acc.z();
+
+	const t_real atmos_frict = params.atmos_frict_coeff;
+	const t_real ground_frict = params.ground_frict_coeff;
+	const t_real ground_absor = params.ground_absor_coeff;
+
+	const float ground_repul = params.ground_repul_coeff;
+	const float ground_level = params.ground_plane_level;
+
+	for (size_t i = 0; i < num_objects; i++) {
+		const float py = positions[i * 3 + 1];
+
+		const t_real vx = velocities[i * 3 + 0];
+		const t_real vy = velocities[i * 3 + 1];
+		const t_real vz = velocities[i * 3 + 2];
+		const t_real m = masses[i];
+
+		// 1 below the ground plane, 0 above; absorption only while approaching
+		const t_real ground_mask = t_real(py < ground_level);
+		const t_real absor_mask = ground_mask * t_real(vy < t_real(0));
+
+		t_real* f = forces + i * 3;
+
+		// F = m*g
+		f[0] += (gx * m);
+		f[1] += (gy * m);
+		f[2] += (gz * m);
+
+		// air friction
+		f[0] += ((-vx) * atmos_frict);
+		f[1] += ((-vy) * atmos_frict);
+		f[2] += ((-vz) * atmos_frict);
+
+		// ground friction (xz), energy absorption and damped-spring repulsion (y)
+		f[0] += (((-vx) * ground_frict) * ground_mask);
+		f[2] += (((-vz) * ground_frict) * ground_mask);
+		f[1] += (((-vy) * ground_absor) * absor_mask);
+		f[1] += (t_real(ground_repul * (ground_level - py)) * ground_mask);
+	}
+}
+
+
+#define ENV_FORCE_KERNEL_ARGS                \
+	t_accum_real* forces,                    \
+	const float* positions,                  \
+	const float* velocities,                 \
+	const float* masses,                     \
+	size_t num_objects,                      \
+	const t_vec3f& gravity_acc,              \
+	const epiks::t_world_params& params
+
+static void calc_env_forces_base(ENV_FORCE_KERNEL_ARGS) {
+	calc_env_forces(forces, positions, velocities, masses, num_objects, gravity_acc, params);
+}
+
+#if (defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)))
+__attribute__((target("avx2")))
+static void calc_env_forces_avx2(ENV_FORCE_KERNEL_ARGS) {
+	calc_env_forces(forces, positions, velocities, masses, num_objects, gravity_acc, params);
+}
+
+__attribute__((target("avx512f")))
+static void calc_env_forces_avx512(ENV_FORCE_KERNEL_ARGS) {
+	calc_env_forces(forces, positions, velocities, masses, num_objects, gravity_acc, params);
+}
+#endif
+
+#undef ENV_FORCE_KERNEL_ARGS
+
+
+struct t_env_force_variant {
+	epiks::t_env_force_kernel kernel;
+	const char* isa;
+};
+
+static t_env_force_variant select_env_force_variant() {
+	#if (defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)))
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx512f"))
+		return {calc_env_forces_avx512, "avx512f"};
+	if (__builtin_cpu_supports("avx2"))
+		return {calc_env_forces_avx2, "avx2"};
+
+	#ifdef __x86_64__
+	return {calc_env_forces_base, "sse2"};
+	#else
+	return {calc_env_forces_base, "x86"};
+	#endif
+	#else
+	return {calc_env_forces_base, "generic"};
+	#endif
+}
+
+static const t_env_force_variant& get_env_force_variant() {
+	static const t_env_force_variant variant = select_env_force_variant();
+	return variant;
+}
+
+
+epiks::t_env_force_kernel epiks::get_env_force_kernel() { return (get_env_force_variant().kernel); }
+const char* epiks::get_env_force_isa() { return (get_env_force_variant().isa); }
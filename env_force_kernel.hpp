@@ -0,0 +1,33 @@
+#ifndef EIGENPHYSIKS_ENV_FORCE_KERNEL_HDR
+#define EIGENPHYSIKS_ENV_FORCE_KERNEL_HDR
+
+#include "eigen_types.hpp"
+#include "world_consts.hpp"
+
+namespace epiks {
+	// adds gravity, air friction and ground friction/absorption/repulsion to
+	// num_objects contiguous objects that share one set of parameters; the
+	// ground terms are masked rather than branched on, so objects above and
+	// below the ground plane take the same path (and results are identical
+	// to adding the terms one by one in that order)
+	//
+	// forces, positions and velocities are packed xyz triples (t_vec3f and
+	// t_vec3<t_accum_real> arrays reinterpreted), masses one per object
+	typedef void (*t_env_force_kernel)(
+		t_accum_real* forces,
+		const float* positions,
+		const float* velocities,
+		const float* masses,
+		size_t num_objects,
+		const t_vec3f& gravity_acc,
+		const t_world_params& params
+	);
+
+	// widest variant (AVX-512, AVX2 or baseline SSE) the running CPU
+	// supports; selected once, on first use
+	t_env_force_kernel get_env_force_kernel();
+
+	const char* get_env_force_isa();
+};
+
+#endif
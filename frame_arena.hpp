@@ -0,0 +1,127 @@
+#ifndef EIGENPHYSIKS_FRAME_ARENA_HDR
+#define EIGENPHYSIKS_FRAME_ARENA_HDR
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace util {
+	// per-thread bump allocator for short-lived (per-tick) temporaries; memory
+	// is handed out linearly and given back wholesale by rewinding to a mark,
+	// so after the first few ticks the same bytes are reused and the heap is
+	// only touched when a tick needs more than any tick before it
+	struct t_frame_arena {
+	public:
+		// rewinds the arena to where it was when the scope was entered
+		struct t_scope {
+		public:
+			t_scope(t_frame_arena& arena): m_arena(arena), m_mark(arena.get_mark()) {}
+			~t_scope() { m_arena.rewind(m_mark); }
+
+			t_scope(const t_scope&) = delete;
+			t_scope& operator = (const t_scope&) = delete;
+
+		private:
+			t_frame_arena& m_arena;
+			size_t m_mark;
+		};
+
+	public:
+		static t_frame_arena& get_thread_arena() {
+			static thread_local t_frame_arena arena;
+			return arena;
+		}
+
+		// heap allocations made by all arenas (and by add_heap_allocs); zero
+		// between two reads means the code in between ran out of reused memory
+		static uint64_t get_num_heap_allocs() { return (s_num_heap_allocs.load(std::memory_order_relaxed)); }
+		static void add_heap_allocs(uint64_t n) { s_num_heap_allocs.fetch_add(n, std::memory_order_relaxed); }
+
+		template<typename type> type* alloc_array(size_t n) { return (reinterpret_cast<type*>(alloc(n * sizeof(type), alignof(type)))); }
+
+		void* alloc(size_t num_bytes, size_t alignment = MIN_ALIGNMENT) {
+			alignment = std::max(alignment, MIN_ALIGNMENT);
+
+			size_t offset = (m_used_bytes + alignment - 1) & ~(alignment - 1);
+
+			if ((offset + num_bytes) > m_block_size) {
+				// start a new block; the old one stays valid until rewound past
+				add_block(std::max({num_bytes + alignment, m_block_size * 2, MIN_BLOCK_SIZE}));
+				offset = (m_used_bytes + alignment - 1) & ~(alignment - 1);
+			}
+
+			m_used_bytes = offset + num_bytes;
+			m_peak_bytes = std::max(m_peak_bytes, m_base_bytes + m_used_bytes);
+
+			return (m_blocks.back().get() + offset);
+		}
+
+		// marks are arena-wide byte counts, valid across blocks
+		size_t get_mark() const { return (m_base_bytes + m_used_bytes); }
+
+		void rewind(size_t mark) {
+			// drop whole blocks allocated after the mark
+			while (m_blocks.size() > 1 && mark < m_base_bytes) {
+				m_blocks.pop_back();
+				m_block_sizes.pop_back();
+				m_base_bytes -= m_block_sizes.back();
+				m_block_size = m_block_sizes.back();
+			}
+
+			m_used_bytes = mark - m_base_bytes;
+
+			if (mark == 0)
+				reset();
+		}
+
+		// releases everything; if one tick needed several blocks, they are
+		// replaced by a single block large enough for all of them
+		void reset() {
+			m_used_bytes = 0;
+
+			if (m_blocks.size() <= 1 && m_block_size >= m_peak_bytes)
+				return;
+
+			m_blocks.clear();
+			m_block_sizes.clear();
+			m_base_bytes = 0;
+			m_block_size = 0;
+
+			add_block(m_peak_bytes);
+		}
+
+	private:
+		void add_block(size_t num_bytes) {
+			if (!m_blocks.empty()) {
+				m_base_bytes += m_block_sizes.back();
+			}
+
+			m_blocks.emplace_back(new uint8_t[num_bytes]);
+			m_block_sizes.push_back(num_bytes);
+
+			m_block_size = num_bytes;
+			m_used_bytes = 0;
+
+			add_heap_allocs(1);
+		}
+
+	private:
+		static constexpr size_t MIN_ALIGNMENT = 16;
+		static constexpr size_t MIN_BLOCK_SIZE = 64 * 1024;
+
+		static inline std::atomic<uint64_t> s_num_heap_allocs = {0};
+
+		// blocks in allocation order; only the last one is being filled
+		std::vector<std::unique_ptr<uint8_t[]>> m_blocks;
+		std::vector<size_t> m_block_sizes;
+
+		size_t m_base_bytes = 0; // total size of all but the last block
+		size_t m_block_size = 0; // size of the last block
+		size_t m_used_bytes = 0; // bytes used in the last block
+		size_t m_peak_bytes = 0;
+	};
+};
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef EIGENPHYSIKS_FRAME_PACER_HDR
+#define EIGENPHYSIKS_FRAME_PACER_HDR
+
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <thread>
+
+#include "global_consts.hpp"
+
+namespace util {
+	// caps the render rate by sleeping until the next frame deadline, so
+	// the idle callback does not spin a core when there is nothing to do
+	struct t_frame_pacer {
+	public:
+		typedef std::chrono::steady_clock t_clock;
+
+		t_frame_pacer() {
+			m_next_frame_time = t_clock::now();
+			m_prev_stat_time = m_next_frame_time;
+			m_prev_cpu_clock = std::clock();
+		}
+
+		// zero means uncapped (paced only by vsync, if the driver enables it)
+		void set_max_rate(uint32_t frames_per_sec) { m_frame_time_ns = (frames_per_sec != 0)? (consts::WALL_SEC_TIME_NS / frames_per_sec): 0; }
+
+		// blocks until the next frame is due
+		void wait_frame() {
+			m_num_frames += 1;
+
+			if (m_frame_time_ns == 0)
+				return;
+
+			const t_clock::time_point curr_time = t_clock::now();
+
+			if (curr_time < m_next_frame_time) {
+				std::this_thread::sleep_until(m_next_frame_time);
+				m_sleep_time_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(t_clock::now() - curr_time).count();
+			}
+
+			m_next_frame_time += std::chrono::nanoseconds(m_frame_time_ns);
+
+			// after a stall start a new schedule instead of bursting frames
+			if (m_next_frame_time < curr_time)
+				m_next_frame_time = curr_time + std::chrono::nanoseconds(m_frame_time_ns);
+		}
+
+		void output_stats(FILE* out) {
+			const t_clock::time_point curr_time = t_clock::now();
+			const std::clock_t curr_cpu_clock = std::clock();
+
+			const double wall_time = std::chrono::duration<double>(curr_time - m_prev_stat_time).count();
+			const double proc_time = double(curr_cpu_clock - m_prev_cpu_clock) / CLOCKS_PER_SEC;
+
+			// process CPU time summed over all threads, so can exceed 100%
+			std::fprintf(out, "[pacer::%s] frames=%u max_rate=%.1fHz sleep=%.1f%% cpu=%.1f%%\n", __func__,
+				m_num_frames,
+				(m_frame_time_ns != 0)? (1e9 / m_frame_time_ns): 0.0,
+				(m_sleep_time_ns * 1e-9 * 100.0) / wall_time,
+				(proc_time * 100.0) / wall_time
+			);
+
+			m_prev_stat_time = curr_time;
+			m_prev_cpu_clock = curr_cpu_clock;
+
+			m_num_frames = 0;
+			m_sleep_time_ns = 0;
+		}
+
+	private:
+		t_clock::time_point m_next_frame_time;
+		t_clock::time_point m_prev_stat_time;
+
+		std::clock_t m_prev_cpu_clock;
+
+		uint64_t m_frame_time_ns = 0;
+		uint64_t m_sleep_time_ns = 0; // since the last output_stats
+
+		uint32_t m_num_frames = 0;
+	};
+};
+
+#endif
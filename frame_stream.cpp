@@ -0,0 +1,369 @@
+#include <cmath>
+
+#include "frame_stream.hpp"
+#include "profiler.hpp"
+
+static uint32_t calc_num_values(uint32_t num_objects, uint32_t num_chains, uint32_t num_pieces) { return (num_objects * 3 + num_chains * 3 + num_pieces * 4); }
+
+static uint32_t zigzag_encode(int32_t v) { return ((uint32_t(v) << 1) ^ uint32_t(v >> 31)); }
+static int32_t zigzag_decode(uint32_t v) { return (int32_t(v >> 1) ^ -int32_t(v & 1)); }
+
+static void append_varint(std::vector<uint8_t>& bytes, uint32_t v) {
+	for (; v >= 0x80; v >>= 7) {
+		bytes.push_back(uint8_t(v | 0x80));
+	}
+
+	bytes.push_back(uint8_t(v));
+}
+
+static bool parse_varint(const uint8_t*& ptr, const uint8_t* end, uint32_t& v) {
+	v = 0;
+
+	for (uint32_t shift = 0; ptr < end && shift < 35; shift += 7) {
+		const uint8_t b = *(ptr++);
+
+		v |= (uint32_t(b & 0x7f) << shift);
+
+		if ((b & 0x80) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+static int32_t quantize_pos(float v) { return (int32_t(std::lround(v / epiks::fstream::POS_QUANT_STEP))); }
+static int32_t quantize_rot(float v) { return (int32_t(std::lround(v * epiks::fstream::ROT_QUANT_SCALE))); }
+
+
+
+bool epiks::t_frame_recorder::start(const char* file_name, bool lossless) {
+	if (m_file != nullptr)
+		return false;
+
+	if ((m_file = std::fopen(file_name, "wb")) == nullptr) {
+		std::fprintf(stderr, "[fr::%s] can not open \"%s\"\n", __func__, file_name);
+		return false;
+	}
+
+	m_running = true;
+	m_lossless = lossless;
+	m_have_header = false;
+	m_topology = {};
+	m_num_frames = 0;
+	m_num_bytes = 0;
+	m_num_dropped = 0;
+
+	m_thread = std::thread([this]() { loop(); });
+	return true;
+}
+
+void epiks::t_frame_recorder::stop() {
+	if (m_file == nullptr)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_running = false;
+	}
+
+	m_cond_var.notify_one();
+	m_thread.join();
+
+	std::fclose(m_file);
+	std::fprintf(stdout, "[fr::%s] wrote %lu frames (%lu bytes, %lu dropped)\n", __func__, (unsigned long) m_num_frames, (unsigned long) m_num_bytes, (unsigned long) m_num_dropped.load());
+
+	m_file = nullptr;
+}
+
+
+void epiks::t_frame_recorder::record(const t_state_snapshot& ss) {
+	EIGENPHYSIKS_PROFILE_ZONE("record");
+
+	fstream::t_frame_values frame;
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		if (m_lossless)
+			m_space_cond_var.wait(lock, [this]() { return (m_queued_frames.size() < MAX_QUEUED_FRAMES); });
+
+		if (m_queued_frames.size() >= MAX_QUEUED_FRAMES) {
+			m_num_dropped += 1;
+			return;
+		}
+
+		// the first frame fixes the topology for the whole recording
+		if (m_topology.chains.empty() && m_topology.obj_positions.empty())
+			m_topology = ss;
+
+		if (!m_free_frames.empty()) {
+			frame = std::move(m_free_frames.back());
+			m_free_frames.pop_back();
+		}
+	}
+
+	if (ss.get_num_objects() != m_topology.get_num_objects() || ss.pieces.size() != m_topology.pieces.size() || ss.get_num_chains() != m_topology.get_num_chains()) {
+		m_num_dropped += 1;
+		return;
+	}
+
+	// quantization is cheap and keeps the queued frames small, the rest
+	// of the encoding happens on the writer thread
+	frame.tick_index = ss.tick_index;
+	frame.values.clear();
+
+	for (const t_pos3f& p: ss.obj_positions) {
+		frame.values.push_back(quantize_pos(p.x()));
+		frame.values.push_back(quantize_pos(p.y()));
+		frame.values.push_back(quantize_pos(p.z()));
+	}
+	for (const t_chain_snapshot& c: ss.chains) {
+		frame.values.push_back(quantize_pos(c.goal_pos.x()));
+		frame.values.push_back(quantize_pos(c.goal_pos.y()));
+		frame.values.push_back(quantize_pos(c.goal_pos.z()));
+	}
+	for (const t_piece_snapshot& p: ss.pieces) {
+		t_quat4f q = t_quat4f(p.rot);
+
+		// q and -q are the same rotation; pick the one that keeps deltas small
+		if (q.w() < 0.0f)
+			q.coeffs() *= -1.0f;
+
+		frame.values.push_back(quantize_rot(q.x()));
+		frame.values.push_back(quantize_rot(q.y()));
+		frame.values.push_back(quantize_rot(q.z()));
+		frame.values.push_back(quantize_rot(q.w()));
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queued_frames.push_back(std::move(frame));
+	}
+
+	m_cond_var.notify_one();
+}
+
+
+void epiks::t_frame_recorder::loop() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while (true) {
+		m_cond_var.wait(lock, [this]() { return (!m_running || !m_queued_frames.empty()); });
+
+		if (m_queued_frames.empty() && !m_running)
+			break;
+
+		fstream::t_frame_values frame = std::move(m_queued_frames.front());
+		m_queued_frames.pop_front();
+
+		// topology is only assigned before the first frame is queued
+		const t_state_snapshot& topology = m_topology;
+
+		lock.unlock();
+
+		if (!m_have_header)
+			write_header(topology);
+
+		write_frame(frame);
+
+		lock.lock();
+		m_free_frames.push_back(std::move(frame));
+		m_space_cond_var.notify_one();
+	}
+}
+
+void epiks::t_frame_recorder::write_header(const t_state_snapshot& ss) {
+	fstream::t_file_header header = {};
+
+	header.magic = fstream::FILE_MAGIC;
+	header.version = fstream::FILE_VERSION;
+	header.key_frame_interval = fstream::KEY_FRAME_INTERVAL;
+	header.pos_quant_step = fstream::POS_QUANT_STEP;
+	header.rot_quant_scale = fstream::ROT_QUANT_SCALE;
+	header.num_objects = ss.get_num_objects();
+	header.num_springs = ss.get_num_springs();
+	header.num_grids = ss.grid_tail_indices.size();
+	header.num_chains = ss.get_num_chains();
+	header.num_pieces = ss.pieces.size();
+
+	std::fwrite(&header, sizeof(header), 1, m_file);
+	std::fwrite(ss.spring_indices.data(), sizeof(uint32_t), ss.spring_indices.size(), m_file);
+	std::fwrite(ss.grid_tail_indices.data(), sizeof(uint32_t), ss.grid_tail_indices.size(), m_file);
+
+	// static parts of the chains; goals and rotations are per frame
+	for (const t_chain_snapshot& c: ss.chains) {
+		const float base_pos[3] = {c.base_pos.x(), c.base_pos.y(), c.base_pos.z()};
+		const uint32_t pieces[2] = {c.piece_offset, c.num_pieces};
+
+		std::fwrite(base_pos, sizeof(base_pos), 1, m_file);
+		std::fwrite(pieces, sizeof(pieces), 1, m_file);
+	}
+	for (const t_piece_snapshot& p: ss.pieces) {
+		std::fwrite(&p.length, sizeof(p.length), 1, m_file);
+	}
+
+	m_prev_values.assign(calc_num_values(header.num_objects, header.num_chains, header.num_pieces), 0);
+	m_have_header = true;
+}
+
+void epiks::t_frame_recorder::write_frame(const fstream::t_frame_values& frame) {
+	const uint8_t key_frame = ((m_num_frames % fstream::KEY_FRAME_INTERVAL) == 0);
+
+	m_frame_bytes.clear();
+
+	for (size_t i = 0; i < frame.values.size(); i++) {
+		append_varint(m_frame_bytes, zigzag_encode(frame.values[i] - (m_prev_values[i] * (1 - key_frame))));
+	}
+
+	// {payload size, tick, key-frame flag} then the varint payload
+	const uint32_t num_bytes = m_frame_bytes.size();
+
+	std::fwrite(&num_bytes, sizeof(num_bytes), 1, m_file);
+	std::fwrite(&frame.tick_index, sizeof(frame.tick_index), 1, m_file);
+	std::fwrite(&key_frame, sizeof(key_frame), 1, m_file);
+	std::fwrite(m_frame_bytes.data(), 1, num_bytes, m_file);
+
+	m_prev_values = frame.values;
+
+	m_num_frames += 1;
+	m_num_bytes += (sizeof(num_bytes) + sizeof(frame.tick_index) + sizeof(key_frame) + num_bytes);
+}
+
+
+
+bool epiks::t_frame_player::open(const char* file_name) {
+	close();
+
+	if ((m_file = std::fopen(file_name, "rb")) == nullptr) {
+		std::fprintf(stderr, "[fp::%s] can not open \"%s\"\n", __func__, file_name);
+		return false;
+	}
+
+	fstream::t_file_header& h = m_header;
+
+	bool ret = (std::fread(&h, sizeof(h), 1, m_file) == 1);
+
+	ret = ret && (h.magic == fstream::FILE_MAGIC && h.version == fstream::FILE_VERSION);
+	ret = ret && (h.pos_quant_step > 0.0f && h.rot_quant_scale > 0.0f);
+
+	if (ret) {
+		m_topology = {};
+		m_topology.spring_indices.resize(h.num_springs * 2);
+		m_topology.grid_tail_indices.resize(h.num_grids);
+		m_topology.obj_positions.resize(h.num_objects);
+		m_topology.chains.resize(h.num_chains);
+		m_topology.pieces.resize(h.num_pieces);
+
+		ret &= (std::fread(m_topology.spring_indices.data(), sizeof(uint32_t), h.num_springs * 2, m_file) == (h.num_springs * 2));
+		ret &= (std::fread(m_topology.grid_tail_indices.data(), sizeof(uint32_t), h.num_grids, m_file) == h.num_grids);
+
+		for (t_chain_snapshot& c: m_topology.chains) {
+			float base_pos[3];
+			uint32_t pieces[2];
+
+			ret &= (std::fread(base_pos, sizeof(base_pos), 1, m_file) == 1);
+			ret &= (std::fread(pieces, sizeof(pieces), 1, m_file) == 1);
+			ret &= ((uint64_t(pieces[0]) + pieces[1]) <= h.num_pieces);
+
+			c.base_pos = {base_pos[0], base_pos[1], base_pos[2]};
+			c.piece_offset = pieces[0];
+			c.num_pieces = pieces[1];
+		}
+		for (t_piece_snapshot& p: m_topology.pieces) {
+			ret &= (std::fread(&p.length, sizeof(p.length), 1, m_file) == 1);
+		}
+		for (uint32_t idx: m_topology.spring_indices) {
+			ret &= (idx < h.num_objects);
+		}
+		for (uint32_t idx: m_topology.grid_tail_indices) {
+			ret &= (idx < h.num_objects);
+		}
+	}
+
+	if (!ret) {
+		std::fprintf(stderr, "[fp::%s] \"%s\" is not a version-%u recording\n", __func__, file_name, fstream::FILE_VERSION);
+		close();
+		return false;
+	}
+
+	m_data_offset = std::ftell(m_file);
+	m_prev_values.assign(calc_num_values(h.num_objects, h.num_chains, h.num_pieces), 0);
+	return true;
+}
+
+void epiks::t_frame_player::close() {
+	if (m_file == nullptr)
+		return;
+
+	std::fclose(m_file);
+	m_file = nullptr;
+}
+
+void epiks::t_frame_player::rewind() {
+	if (m_file == nullptr)
+		return;
+
+	std::fseek(m_file, m_data_offset, SEEK_SET);
+	std::fill(m_prev_values.begin(), m_prev_values.end(), 0);
+}
+
+
+bool epiks::t_frame_player::read_frame(t_state_snapshot& ss) {
+	EIGENPHYSIKS_PROFILE_ZONE("replay");
+
+	if (m_file == nullptr)
+		return false;
+
+	uint32_t num_bytes = 0;
+	uint64_t tick_index = 0;
+	uint8_t key_frame = 0;
+
+	if (std::fread(&num_bytes, sizeof(num_bytes), 1, m_file) != 1)
+		return false;
+	if (std::fread(&tick_index, sizeof(tick_index), 1, m_file) != 1)
+		return false;
+	if (std::fread(&key_frame, sizeof(key_frame), 1, m_file) != 1)
+		return false;
+
+	m_frame_bytes.resize(num_bytes);
+
+	if (std::fread(m_frame_bytes.data(), 1, num_bytes, m_file) != num_bytes)
+		return false;
+
+	const uint8_t* ptr = m_frame_bytes.data();
+	const uint8_t* end = m_frame_bytes.data() + num_bytes;
+
+	for (int32_t& v: m_prev_values) {
+		uint32_t u = 0;
+
+		if (!parse_varint(ptr, end, u))
+			return false;
+
+		v = zigzag_decode(u) + (v * (key_frame == 0));
+	}
+
+	// topology (springs, bases, lengths) is only copied into fresh snapshots
+	if (ss.spring_indices.size() != m_topology.spring_indices.size() || ss.pieces.size() != m_topology.pieces.size() || ss.chains.size() != m_topology.chains.size())
+		ss = m_topology;
+
+	const float pos_step = m_header.pos_quant_step;
+	const float rot_scale = m_header.rot_quant_scale;
+
+	const int32_t* vals = m_prev_values.data();
+
+	for (t_pos3f& p: ss.obj_positions) {
+		p = {vals[0] * pos_step, vals[1] * pos_step, vals[2] * pos_step};
+		vals += 3;
+	}
+	for (t_chain_snapshot& c: ss.chains) {
+		c.goal_pos = {vals[0] * pos_step, vals[1] * pos_step, vals[2] * pos_step};
+		vals += 3;
+	}
+	for (t_piece_snapshot& p: ss.pieces) {
+		p.rot = t_rot4f(t_quat4f(vals[3] / rot_scale, vals[0] / rot_scale, vals[1] / rot_scale, vals[2] / rot_scale).normalized());
+		vals += 4;
+	}
+
+	ss.tick_index = tick_index;
+	return true;
+}
@@ -0,0 +1,134 @@
+#ifndef EIGENPHYSIKS_FRAME_STREAM_HDR
+#define EIGENPHYSIKS_FRAME_STREAM_HDR
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "state_snapshot.hpp"
+
+namespace epiks {
+	// append-only recording of per-tick snapshots; after a header holding the
+	// (static) topology every frame stores object positions, chain goals and
+	// piece rotations quantized to integers, as zigzag-varint deltas against
+	// the previous frame (or against zero for periodic key-frames)
+	namespace fstream {
+		static constexpr uint64_t FILE_MAGIC = 0x434552534b495045ull; // "EPIKSREC"
+		static constexpr uint32_t FILE_VERSION = 1;
+
+		static constexpr float POS_QUANT_STEP = 1.0f / 8192.0f; // meters
+		static constexpr float ROT_QUANT_SCALE = 32767.0f; // per quaternion component
+
+		static constexpr uint32_t KEY_FRAME_INTERVAL = 120;
+
+		struct t_file_header {
+			uint64_t magic;
+			uint32_t version;
+			uint32_t key_frame_interval;
+
+			float pos_quant_step;
+			float rot_quant_scale;
+
+			uint32_t num_objects;
+			uint32_t num_springs;
+			uint32_t num_grids;
+			uint32_t num_chains;
+			uint32_t num_pieces;
+			uint32_t padding;
+		};
+
+		// quantized values of one frame, in file order
+		struct t_frame_values {
+			uint64_t tick_index;
+
+			// {obj_positions, chain goal positions, piece quaternions}
+			std::vector<int32_t> values;
+		};
+	};
+
+
+	// encodes and writes on a background thread; record only copies the
+	// snapshot into a queue and never blocks on I/O (frames are dropped,
+	// and counted, if the writer falls too far behind)
+	struct t_frame_recorder {
+	public:
+		~t_frame_recorder() { stop(); }
+
+		// if lossless, record waits for the writer instead of dropping frames
+		// (for unpaced batch runs that must not lose anything)
+		bool start(const char* file_name, bool lossless = false);
+		void stop();
+
+		void record(const t_state_snapshot& ss);
+
+		bool is_recording() const { return (m_file != nullptr); }
+
+	private:
+		void loop();
+		void write_header(const t_state_snapshot& ss);
+		void write_frame(const fstream::t_frame_values& frame);
+
+	private:
+		static constexpr size_t MAX_QUEUED_FRAMES = 256;
+
+		FILE* m_file = nullptr;
+
+		std::thread m_thread;
+		std::mutex m_mutex;
+		std::condition_variable m_cond_var;
+		std::condition_variable m_space_cond_var;
+
+		std::deque<fstream::t_frame_values> m_queued_frames;
+		std::vector<fstream::t_frame_values> m_free_frames;
+
+		// topology of the first frame; written once by record
+		t_state_snapshot m_topology;
+
+		std::vector<int32_t> m_prev_values;
+		std::vector<uint8_t> m_frame_bytes;
+
+		bool m_running = false;
+		bool m_lossless = false;
+		bool m_have_header = false;
+
+		uint64_t m_num_frames = 0;
+		uint64_t m_num_bytes = 0;
+
+		std::atomic<uint64_t> m_num_dropped = {0};
+	};
+
+
+	// decodes a recording back into snapshots, e.g. to render it without physics
+	struct t_frame_player {
+	public:
+		~t_frame_player() { close(); }
+
+		bool open(const char* file_name);
+		void close();
+
+		// restarts at the first frame, which is always a key-frame
+		void rewind();
+
+		bool is_open() const { return (m_file != nullptr); }
+
+		// false at the end of the recording (or on a damaged frame)
+		bool read_frame(t_state_snapshot& ss);
+
+	private:
+		FILE* m_file = nullptr;
+
+		long m_data_offset = 0;
+
+		fstream::t_file_header m_header;
+		t_state_snapshot m_topology;
+
+		std::vector<int32_t> m_prev_values;
+		std::vector<uint8_t> m_frame_bytes;
+	};
+};
+
+#endif
@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "checkpoint.hpp"
+#include "env_force_kernel.hpp"
+#include "frame_arena.hpp"
+#include "frame_stream.hpp"
+#include "global_consts.hpp"
+#include "image_writer.hpp"
+#include "physics_state.hpp"
+#include "profiler.hpp"
+#include "scene_loader.hpp"
+#include "shm_export.hpp"
+#include "soft_renderer.hpp"
+#include "state_snapshot.hpp"
+#include "system_timer.hpp"
+#include "telemetry.hpp"
+#include "trace_writer.hpp"
+
+// runs the simulation without a window (or any GL), as fast as it will go
+static epiks::t_physics_state g_physics_state;
+static epiks::t_state_snapshot g_snapshot;
+static epiks::t_frame_recorder g_frame_recorder;
+static epiks::t_shm_exporter g_shm_exporter;
+
+static raster::t_renderer g_soft_renderer;
+static raster::t_framebuffer g_framebuffer;
+static util::t_image_writer g_image_writer;
+
+int main(int argc, char** argv) {
+	uint64_t num_ticks = consts::SIM_STEP_RATE * 60;
+
+	epiks::t_physics_rates physics_rates;
+
+	const char* load_ckpt_file = nullptr;
+	const char* save_ckpt_file = nullptr;
+	const char* record_file = nullptr;
+	const char* scene_file = nullptr;
+	const char* capture_prefix = nullptr;
+	const char* shm_export_name = nullptr;
+
+	// software-rendered frames, every N ticks (60 per sim-second by default)
+	uint32_t capture_interval = std::max(consts::SIM_STEP_RATE / 60, 1u);
+	uint32_t capture_size = 512;
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--ticks") == 0 && (i + 1) < argc)
+			num_ticks = std::strtoull(argv[++i], nullptr, 10);
+
+		// per-subsystem rates (Hz); chains may run slower than the springs
+		if (std::strcmp(argv[i], "--chain-rate") == 0 && (i + 1) < argc)
+			physics_rates.chain_rate_hz = std::max(std::atoi(argv[++i]), 1);
+		if (std::strcmp(argv[i], "--spring-rate") == 0 && (i + 1) < argc)
+			physics_rates.spring_rate_hz = std::max(std::atoi(argv[++i]), 1);
+		if (std::strcmp(argv[i], "--lerp-pulls") == 0)
+			physics_rates.lerp_pulls = true;
+
+		// start from (and/or finish with) a binary checkpoint instead of init
+		if (std::strcmp(argv[i], "--load-checkpoint") == 0 && (i + 1) < argc)
+			load_ckpt_file = argv[++i];
+		if (std::strcmp(argv[i], "--save-checkpoint") == 0 && (i + 1) < argc)
+			save_ckpt_file = argv[++i];
+		// text or compiled scene (see scene_loader.hpp); --compile-scene
+		// <text> <binary> only converts the former into the latter
+		if (std::strcmp(argv[i], "--scene") == 0 && (i + 1) < argc)
+			scene_file = argv[++i];
+		if (std::strcmp(argv[i], "--compile-scene") == 0 && (i + 2) < argc)
+			return (epiks::compile_scene(argv[i + 1], argv[i + 2])? 0: 1);
+
+		if (std::strcmp(argv[i], "--record") == 0 && (i + 1) < argc)
+			record_file = argv[++i];
+		// --shm-export <name> publishes every tick to a shared-memory ring
+		// that other processes can map (see shm_export.hpp)
+		if (std::strcmp(argv[i], "--shm-export") == 0 && (i + 1) < argc)
+			shm_export_name = argv[++i];
+
+		// --capture <prefix> writes <prefix>000000.ppm, ... (see image_writer.hpp)
+		if (std::strcmp(argv[i], "--capture") == 0 && (i + 1) < argc)
+			capture_prefix = argv[++i];
+		if (std::strcmp(argv[i], "--capture-every") == 0 && (i + 1) < argc)
+			capture_interval = std::max(std::atoi(argv[++i]), 1);
+		if (std::strcmp(argv[i], "--capture-size") == 0 && (i + 1) < argc)
+			capture_size = std::max(std::atoi(argv[++i]), 16);
+
+		// --trace <file> records a Chrome trace-event timeline
+		if (std::strcmp(argv[i], "--trace") == 0 && (i + 1) < argc)
+			util::t_trace_writer::get_instance().start(argv[++i]);
+		// --telemetry <file> also dumps the per-second counters as CSV (or
+		// JSON lines if <file> ends in .json), see telemetry.hpp
+		if (std::strcmp(argv[i], "--telemetry") == 0 && (i + 1) < argc)
+			util::t_telemetry::get_instance().start_dump(argv[++i]);
+	}
+
+	// unpaced, so the recorder (and image writer) may block rather than drop frames
+	if (record_file != nullptr && !g_frame_recorder.start(record_file, true))
+		return 1;
+	if (capture_prefix != nullptr && !g_image_writer.start(capture_prefix, true))
+		return 1;
+
+	g_framebuffer.resize(capture_size, capture_size);
+
+	util::t_system_timer run_timer;
+	util::t_system_timer sec_timer;
+
+	g_physics_state.set_rates(physics_rates);
+
+	if (load_ckpt_file != nullptr) {
+		if (!epiks::load_checkpoint(g_physics_state, load_ckpt_file))
+			return 1;
+	} else if (scene_file != nullptr) {
+		if (!epiks::load_scene(g_physics_state, scene_file))
+			return 1;
+	} else {
+		g_physics_state.init();
+	}
+
+	std::fprintf(stdout, "[headless] {chain,spring}_rate={%.1f,%.1f}Hz\n", g_physics_state.get_chain_rate().get_rate_hz(), g_physics_state.get_spring_rate().get_rate_hz());
+	std::fprintf(stdout, "[headless] env_force_isa=%s\n", epiks::get_env_force_isa());
+
+	if (shm_export_name != nullptr) {
+		g_snapshot.capture(g_physics_state, 0);
+
+		if (!g_shm_exporter.start(shm_export_name, g_snapshot))
+			return 1;
+	}
+
+	run_timer.tick_time();
+	sec_timer.tick_time();
+
+	uint64_t sec_ticks = 0;
+	uint64_t warm_heap_allocs = 0;
+
+	for (uint64_t n = 0; n < num_ticks; n++) {
+		{
+			EIGENPHYSIKS_PROFILE_ZONE("tick");
+			g_physics_state.step(consts::SIM_STEP_TIME_NS * 0.001f * 0.001f * 0.001f);
+		}
+
+		// arenas are sized by the end of the first simulated second
+		if ((n + 1) == consts::SIM_STEP_RATE)
+			warm_heap_allocs = util::t_frame_arena::get_num_heap_allocs();
+
+		const bool capture_frame = g_image_writer.is_running() && ((n + 1) % capture_interval) == 0;
+
+		if (g_frame_recorder.is_recording() || g_shm_exporter.is_running() || capture_frame)
+			g_snapshot.capture(g_physics_state, n + 1);
+
+		if (g_frame_recorder.is_recording())
+			g_frame_recorder.record(g_snapshot);
+		if (g_shm_exporter.is_running())
+			g_shm_exporter.export_frame(g_snapshot);
+
+		if (capture_frame) {
+			g_soft_renderer.render(g_snapshot, g_framebuffer);
+			g_image_writer.write(g_framebuffer.get_pixels(), g_framebuffer.get_width(), g_framebuffer.get_height());
+		}
+
+		sec_ticks += 1;
+
+		// same once-a-second report as the windowed build
+		if (sec_timer.tock_time() >= consts::WALL_SEC_TIME_NS) {
+			std::fprintf(stdout, "[headless] ticks=%lu ticks_per_sec=%.1f\n", (unsigned long) (n + 1), (sec_ticks * 1e9) / sec_timer.diff_time());
+			util::t_profiler::get_instance().output_stats(stdout);
+			util::t_telemetry::get_instance().output_stats(stdout);
+
+			sec_timer.tick_time();
+			sec_ticks = 0;
+		}
+	}
+
+	const uint64_t run_time_ns = run_timer.tock_time();
+
+	g_frame_recorder.stop();
+	g_shm_exporter.stop();
+	g_image_writer.stop();
+
+	// counters since the last once-a-second report (all of them for short runs)
+	util::t_telemetry::get_instance().output_stats(stdout);
+
+	// sim-time per wall-time; >1 means faster than real-time
+	const double sim_time = num_ticks * double(consts::SIM_STEP_SIZE);
+	const double run_time = run_time_ns * 1e-9;
+
+	std::fprintf(stdout, "[headless] ticks=%lu run_time=%.3fs ticks_per_sec=%.1f realtime_factor=%.2f\n", (unsigned long) num_ticks, run_time, num_ticks / run_time, sim_time / run_time);
+
+	const t_pos3f& tail_pos = g_physics_state.get_spring_world().get_pos(g_physics_state.get_spring_world().get_num_objects() - 1);
+
+	// cheap check that two runs (or two builds) simulated the same thing
+	std::fprintf(stdout, "[headless] tail_pos={%f,%f,%f}\n", tail_pos.x(), tail_pos.y(), tail_pos.z());
+
+	// anything but zero after warm-up means per-tick temporaries still hit the heap
+	if (num_ticks > consts::SIM_STEP_RATE)
+		std::fprintf(stdout, "[headless] arena_heap_allocs={warmup=%lu,steady=%lu}\n", (unsigned long) warm_heap_allocs, (unsigned long) (util::t_frame_arena::get_num_heap_allocs() - warm_heap_allocs));
+
+	if (save_ckpt_file != nullptr && !epiks::save_checkpoint(g_physics_state, save_ckpt_file))
+		return 1;
+
+	util::t_trace_writer::get_instance().stop();
+	util::t_telemetry::get_instance().stop_dump();
+	return 0;
+}
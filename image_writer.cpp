@@ -0,0 +1,118 @@
+#include <cstdio>
+
+#include "image_writer.hpp"
+#include "profiler.hpp"
+
+bool util::t_image_writer::start(const char* file_prefix, bool lossless) {
+	if (m_running)
+		return false;
+
+	m_file_prefix = file_prefix;
+	m_running = true;
+	m_lossless = lossless;
+	m_num_images = 0;
+	m_num_written = 0;
+	m_num_dropped = 0;
+
+	m_thread = std::thread([this]() { loop(); });
+	return true;
+}
+
+void util::t_image_writer::stop() {
+	if (!m_running)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_running = false;
+	}
+
+	m_cond_var.notify_one();
+	m_thread.join();
+
+	std::fprintf(stdout, "[iw::%s] wrote %lu of %lu images (%lu dropped)\n", __func__, (unsigned long) m_num_written, (unsigned long) m_num_images, (unsigned long) m_num_dropped.load());
+}
+
+
+void util::t_image_writer::write(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height) {
+	EIGENPHYSIKS_PROFILE_ZONE("iw::write");
+
+	t_image image;
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		if (m_lossless)
+			m_space_cond_var.wait(lock, [this]() { return (m_queued_images.size() < MAX_QUEUED_IMAGES); });
+
+		// numbered by submission, so dropped images leave gaps
+		image.index = m_num_images++;
+
+		if (m_queued_images.size() >= MAX_QUEUED_IMAGES) {
+			m_num_dropped += 1;
+			return;
+		}
+
+		if (!m_free_images.empty()) {
+			const uint64_t index = image.index;
+
+			image = std::move(m_free_images.back());
+			image.index = index;
+			m_free_images.pop_back();
+		}
+	}
+
+	image.width = width;
+	image.height = height;
+	image.pixels.assign(pixels.begin(), pixels.end());
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queued_images.push_back(std::move(image));
+	}
+
+	m_cond_var.notify_one();
+}
+
+
+void util::t_image_writer::loop() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while (true) {
+		m_cond_var.wait(lock, [this]() { return (!m_running || !m_queued_images.empty()); });
+
+		if (m_queued_images.empty() && !m_running)
+			break;
+
+		t_image image = std::move(m_queued_images.front());
+		m_queued_images.pop_front();
+
+		lock.unlock();
+
+		const bool written = write_image(image);
+
+		lock.lock();
+
+		m_num_written += written;
+		m_free_images.push_back(std::move(image));
+		m_space_cond_var.notify_one();
+	}
+}
+
+bool util::t_image_writer::write_image(const t_image& image) const {
+	char file_name[1024];
+
+	std::snprintf(file_name, sizeof(file_name), "%s%06lu.ppm", m_file_prefix.c_str(), (unsigned long) image.index);
+
+	FILE* file = std::fopen(file_name, "wb");
+
+	if (file == nullptr) {
+		std::fprintf(stderr, "[iw::%s] can not open \"%s\"\n", __func__, file_name);
+		return false;
+	}
+
+	std::fprintf(file, "P6\n%u %u\n255\n", image.width, image.height);
+	std::fwrite(image.pixels.data(), 1, image.pixels.size(), file);
+	std::fclose(file);
+	return true;
+}
@@ -0,0 +1,65 @@
+#ifndef EIGENPHYSIKS_IMAGE_WRITER_HDR
+#define EIGENPHYSIKS_IMAGE_WRITER_HDR
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace util {
+	// writes numbered binary PPM images (<prefix>000000.ppm, ...) on a
+	// background thread, e.g. as input for image diffs or an encoder such as
+	// ffmpeg -i <prefix>%06d.ppm; like t_frame_recorder, submitting only
+	// copies the pixels and drops images if the writer falls behind
+	struct t_image_writer {
+	public:
+		~t_image_writer() { stop(); }
+
+		// if lossless, write waits for the writer instead of dropping images
+		bool start(const char* file_prefix, bool lossless = false);
+		void stop();
+
+		// rows top to bottom, RGB8
+		void write(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height);
+
+		bool is_running() const { return m_running; }
+
+	private:
+		struct t_image {
+			uint64_t index;
+			uint32_t width;
+			uint32_t height;
+
+			std::vector<uint8_t> pixels;
+		};
+
+		void loop();
+		bool write_image(const t_image& image) const;
+
+	private:
+		static constexpr size_t MAX_QUEUED_IMAGES = 16;
+
+		std::string m_file_prefix;
+
+		std::thread m_thread;
+		std::mutex m_mutex;
+		std::condition_variable m_cond_var;
+		std::condition_variable m_space_cond_var;
+
+		std::deque<t_image> m_queued_images;
+		std::vector<t_image> m_free_images;
+
+		bool m_running = false;
+		bool m_lossless = false;
+
+		uint64_t m_num_images = 0;
+		uint64_t m_num_written = 0;
+
+		std::atomic<uint64_t> m_num_dropped = {0};
+	};
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include <GL/freeglut.h>
 
+#include "eigen_math.hpp"
 #include "opengl_camera.hpp"
 
 void opengl::t_camera::update() {
@@ -15,15 +16,35 @@ void opengl::t_camera::update() {
 }
 
 
+t_mat44f opengl::t_camera::calc_proj_mat() const { return (math::calc_perspective_matrix(60.0f, 1.0f, 1.0f, 100.0f)); }
+t_mat44f opengl::t_camera::calc_view_mat() const { return (math::calc_look_at_matrix(m_pos, m_tgt, m_vec[consts::AXIS_IDX_Y])); }
+
+opengl::t_frustum opengl::t_camera::calc_frustum() const {
+	const t_mat44f m = calc_proj_mat() * calc_view_mat();
+
+	t_frustum f;
+
+	// planes are sums and differences of the rows of the clip matrix
+	for (uint32_t i = 0; i < 6; i++) {
+		const float s = ((i & 1) == 0)? 1.0f: -1.0f;
+		const Eigen::Matrix<float, 1, 4> p = m.row(3) + m.row(i >> 1) * s;
+		const float inv_len = 1.0f / p.head<3>().norm();
+
+		f.plane_normals[i] = p.head<3>().transpose() * inv_len;
+		f.plane_dists[i] = p(3) * inv_len;
+	}
+
+	return f;
+}
+
+
 void opengl::t_camera::set_gl_proj_mat() const {
 	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-	gluPerspective(60.0f, 1.0f, 1.0f, 100.0f);
+	glLoadMatrixf(calc_proj_mat().data());
 }
 
 void opengl::t_camera::set_gl_view_mat() const {
 	glMatrixMode(GL_MODELVIEW);
-	glLoadIdentity();
-	gluLookAt(m_pos.x(), m_pos.y(), m_pos.z(),  m_tgt.x(), m_tgt.y(), m_tgt.z(),  m_vec[consts::AXIS_IDX_Y].x(), m_vec[consts::AXIS_IDX_Y].y(), m_vec[consts::AXIS_IDX_Y].z());
+	glLoadMatrixf(calc_view_mat().data());
 }
 
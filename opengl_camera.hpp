@@ -7,6 +7,26 @@
 #include "world_consts.hpp"
 
 namespace opengl {
+	// world-space clip planes, normals pointing inwards; order is left,
+	// right, bottom, top, near, far
+	struct t_frustum {
+	public:
+		// conservative; true for spheres that merely touch the frustum
+		bool test_sphere(const t_pos3f& center, float radius) const {
+			for (uint32_t i = 0; i < 6; i++) {
+				if ((plane_normals[i].dot(center) + plane_dists[i]) < -radius)
+					return false;
+			}
+
+			return true;
+		}
+
+	public:
+		t_vec3f plane_normals[6];
+		float plane_dists[6];
+	};
+
+
 	struct t_camera {
 	public:
 		t_camera() {
@@ -32,6 +52,12 @@ namespace opengl {
 			m_pos.z() = std::max(mins.z(), std::min(maxs.z(), m_pos.z()));
 		}
 
+		// column-major, as gluPerspective and gluLookAt would build them
+		t_mat44f calc_proj_mat() const;
+		t_mat44f calc_view_mat() const;
+
+		t_frustum calc_frustum() const;
+
 		void set_gl_proj_mat() const;
 		void set_gl_view_mat() const;
 
@@ -0,0 +1,153 @@
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include "opengl_debug_draw.hpp"
+#include "profiler.hpp"
+
+// unit-sphere vertices double as normals; shaded with a headlight so debug
+// shapes read clearly without depending on the scene lights
+static const char* DEBUG_VERT_SHADER_SRC = R"(
+	#version 330 core
+
+	layout(location = 0) in vec3 a_vert_pos;
+	layout(location = 1) in vec4 a_inst_pos_rad;
+	layout(location = 2) in vec4 a_inst_color;
+
+	uniform mat4 u_proj_mat;
+	uniform mat4 u_view_mat;
+
+	out vec3 v_eye_nrm;
+	out vec4 v_color;
+
+	void main() {
+		v_eye_nrm = mat3(u_view_mat) * a_vert_pos;
+		v_color = a_inst_color;
+
+		gl_Position = u_proj_mat * (u_view_mat * vec4(a_inst_pos_rad.xyz + a_vert_pos * a_inst_pos_rad.w, 1.0));
+	}
+)";
+
+static const char* DEBUG_FRAG_SHADER_SRC = R"(
+	#version 330 core
+
+	in vec3 v_eye_nrm;
+	in vec4 v_color;
+
+	out vec4 f_color;
+
+	void main() {
+		f_color = vec4(v_color.rgb * (0.35 + 0.65 * max(normalize(v_eye_nrm).z, 0.0)), v_color.a);
+	}
+)";
+
+
+bool opengl::t_debug_draw::init() {
+	std::vector<float> verts;
+	std::vector<uint16_t> indices;
+
+	verts.reserve((num_sphere_stacks + 1) * (num_sphere_slices + 1) * 3);
+	indices.reserve(num_sphere_stacks * num_sphere_slices * 6);
+
+	for (uint32_t i = 0; i <= num_sphere_stacks; i++) {
+		const float theta = (i * M_PI) / num_sphere_stacks;
+
+		for (uint32_t j = 0; j <= num_sphere_slices; j++) {
+			const float phi = (j * 2.0f * M_PI) / num_sphere_slices;
+
+			verts.push_back(std::sin(theta) * std::cos(phi));
+			verts.push_back(std::cos(theta));
+			verts.push_back(std::sin(theta) * std::sin(phi));
+		}
+	}
+
+	// two counter-clockwise (seen from outside) triangles per quad
+	for (uint32_t i = 0; i < num_sphere_stacks; i++) {
+		for (uint32_t j = 0; j < num_sphere_slices; j++) {
+			const uint16_t v0 = (i    ) * (num_sphere_slices + 1) + j;
+			const uint16_t v1 = (i + 1) * (num_sphere_slices + 1) + j;
+
+			indices.insert(indices.end(), {v0, uint16_t(v0 + 1), v1});
+			indices.insert(indices.end(), {uint16_t(v0 + 1), uint16_t(v1 + 1), v1});
+		}
+	}
+
+	m_num_sphere_indices = indices.size();
+	m_max_sphere_insts = 0;
+
+	glGenVertexArrays(1, &m_sphere_vao_id);
+	glBindVertexArray(m_sphere_vao_id);
+
+	glGenBuffers(1, &m_sphere_vbo_id);
+	glBindBuffer(GL_ARRAY_BUFFER, m_sphere_vbo_id);
+	glBufferStorage(GL_ARRAY_BUFFER, verts.size() * sizeof(float), verts.data(), 0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, nullptr);
+
+	glGenBuffers(1, &m_sphere_ibo_id);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_sphere_ibo_id);
+	glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), 0);
+
+	// (re)allocated by flush whenever the number of instances outgrows it
+	glGenBuffers(1, &m_sphere_inst_vbo_id);
+	glBindBuffer(GL_ARRAY_BUFFER, m_sphere_inst_vbo_id);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(t_sphere_inst), reinterpret_cast<void*>(offsetof(t_sphere_inst, pos_rad)));
+	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(t_sphere_inst), reinterpret_cast<void*>(offsetof(t_sphere_inst, color)));
+	glVertexAttribDivisor(1, 1);
+	glVertexAttribDivisor(2, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (!m_shader.init(DEBUG_VERT_SHADER_SRC, DEBUG_FRAG_SHADER_SRC))
+		return false;
+
+	m_proj_mat_loc = m_shader.get_uniform_loc("u_proj_mat");
+	m_view_mat_loc = m_shader.get_uniform_loc("u_view_mat");
+	return true;
+}
+
+void opengl::t_debug_draw::kill() {
+	glDeleteVertexArrays(1, &m_sphere_vao_id);
+	glDeleteBuffers(1, &m_sphere_vbo_id);
+	glDeleteBuffers(1, &m_sphere_ibo_id);
+	glDeleteBuffers(1, &m_sphere_inst_vbo_id);
+
+	m_shader.kill();
+	m_sphere_insts.clear();
+}
+
+
+void opengl::t_debug_draw::flush(const t_mat44f& proj_mat, const t_mat44f& view_mat) {
+	EIGENPHYSIKS_PROFILE_ZONE("render::debug_draw");
+
+	if (m_enabled && !m_sphere_insts.empty()) {
+		glBindBuffer(GL_ARRAY_BUFFER, m_sphere_inst_vbo_id);
+
+		// orphan (or grow) the instance buffer, then fill it in one go
+		m_max_sphere_insts = std::max(m_max_sphere_insts, uint32_t(m_sphere_insts.size()));
+
+		glBufferData(GL_ARRAY_BUFFER, m_max_sphere_insts * sizeof(t_sphere_inst), nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, m_sphere_insts.size() * sizeof(t_sphere_inst), m_sphere_insts.data());
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		m_shader.enable();
+
+		glUniformMatrix4fv(m_proj_mat_loc, 1, GL_FALSE, proj_mat.data());
+		glUniformMatrix4fv(m_view_mat_loc, 1, GL_FALSE, view_mat.data());
+
+		glBindVertexArray(m_sphere_vao_id);
+		glDrawElementsInstanced(GL_TRIANGLES, m_num_sphere_indices, GL_UNSIGNED_SHORT, nullptr, m_sphere_insts.size());
+		glBindVertexArray(0);
+
+		m_shader.disable();
+	}
+
+	m_sphere_insts.clear();
+}
@@ -0,0 +1,62 @@
+#ifndef EIGENPHYSIKS_OPENGL_DEBUG_DRAW_HDR
+#define EIGENPHYSIKS_OPENGL_DEBUG_DRAW_HDR
+
+#include <vector>
+
+#include "eigen_types.hpp"
+#include "opengl_shader.hpp"
+
+namespace opengl {
+	// batched debug primitives; shapes are queued while building a frame and
+	// drawn by flush with one instanced call per prebuilt mesh, or skipped
+	// entirely (including the queueing) while the layer is disabled
+	struct t_debug_draw {
+	public:
+		bool init();
+		void kill();
+
+		void add_sphere(const t_pos3f& pos, float radius, float r, float g, float b) {
+			if (!m_enabled)
+				return;
+
+			m_sphere_insts.push_back({{pos.x(), pos.y(), pos.z(), radius}, {r, g, b, 1.0f}});
+		}
+
+		void flush(const t_mat44f& proj_mat, const t_mat44f& view_mat);
+
+		void set_enabled(bool enabled) { m_enabled = enabled; }
+		void toggle_enabled() { m_enabled = !m_enabled; }
+
+		bool is_enabled() const { return m_enabled; }
+
+	private:
+		struct t_sphere_inst {
+			float pos_rad[4]; // xyz=center, w=radius
+			float color[4];
+		};
+
+		// same tessellation gluSphere(0.1, 20, 20) used to get
+		static constexpr uint32_t num_sphere_slices = 20;
+		static constexpr uint32_t num_sphere_stacks = 20;
+
+	private:
+		uint32_t m_sphere_vao_id = 0;
+		uint32_t m_sphere_vbo_id = 0;
+		uint32_t m_sphere_ibo_id = 0;
+		uint32_t m_sphere_inst_vbo_id = 0;
+
+		uint32_t m_num_sphere_indices = 0;
+		uint32_t m_max_sphere_insts = 0;
+
+		int32_t m_proj_mat_loc = -1;
+		int32_t m_view_mat_loc = -1;
+
+		bool m_enabled = true;
+
+		std::vector<t_sphere_inst> m_sphere_insts;
+
+		opengl::t_shader_program m_shader;
+	};
+};
+
+#endif
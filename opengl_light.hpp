@@ -21,6 +21,11 @@ namespace opengl {
 		void set_ambi_clr(float r, float g, float b, float a) { m_ambi_clr[0] = r; m_ambi_clr[1] = g; m_ambi_clr[2] = b; m_ambi_clr[3] = a; }
 		void set_position(float x, float y, float z, float w) { m_position[0] = x; m_position[1] = y; m_position[2] = z; m_position[3] = w; }
 
+		// for shaders, which do not see the fixed-function light state
+		const float* get_diff_clr() const { return m_diff_clr; }
+		const float* get_ambi_clr() const { return m_ambi_clr; }
+		const float* get_position() const { return m_position; }
+
 	private:
 		uint8_t m_id;
 
@@ -0,0 +1,76 @@
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <cstdio>
+
+#include "opengl_shader.hpp"
+
+static uint32_t compile_shader(uint32_t type, const char* src) {
+	const uint32_t shader_id = glCreateShader(type);
+
+	int32_t status = GL_FALSE;
+
+	glShaderSource(shader_id, 1, &src, nullptr);
+	glCompileShader(shader_id);
+	glGetShaderiv(shader_id, GL_COMPILE_STATUS, &status);
+
+	if (status == GL_TRUE)
+		return shader_id;
+
+	char info_log[1024] = {0};
+
+	glGetShaderInfoLog(shader_id, sizeof(info_log), nullptr, info_log);
+	glDeleteShader(shader_id);
+
+	std::fprintf(stderr, "[shader::%s] %s shader failed to compile:\n%s\n", __func__, (type == GL_VERTEX_SHADER)? "vertex": "fragment", info_log);
+	return 0;
+}
+
+
+bool opengl::t_shader_program::init(const char* vert_src, const char* frag_src) {
+	const uint32_t vert_id = compile_shader(GL_VERTEX_SHADER, vert_src);
+	const uint32_t frag_id = compile_shader(GL_FRAGMENT_SHADER, frag_src);
+
+	if (vert_id == 0 || frag_id == 0) {
+		glDeleteShader(vert_id);
+		glDeleteShader(frag_id);
+		return false;
+	}
+
+	int32_t status = GL_FALSE;
+
+	m_prog_id = glCreateProgram();
+
+	glAttachShader(m_prog_id, vert_id);
+	glAttachShader(m_prog_id, frag_id);
+	glLinkProgram(m_prog_id);
+	glGetProgramiv(m_prog_id, GL_LINK_STATUS, &status);
+
+	// the program keeps its own reference
+	glDetachShader(m_prog_id, vert_id);
+	glDetachShader(m_prog_id, frag_id);
+	glDeleteShader(vert_id);
+	glDeleteShader(frag_id);
+
+	if (status == GL_TRUE)
+		return true;
+
+	char info_log[1024] = {0};
+
+	glGetProgramInfoLog(m_prog_id, sizeof(info_log), nullptr, info_log);
+	std::fprintf(stderr, "[shader::%s] program failed to link:\n%s\n", __func__, info_log);
+
+	kill();
+	return false;
+}
+
+void opengl::t_shader_program::kill() {
+	glDeleteProgram(m_prog_id);
+	m_prog_id = 0;
+}
+
+
+void opengl::t_shader_program::enable() const { glUseProgram(m_prog_id); }
+void opengl::t_shader_program::disable() const { glUseProgram(0); }
+
+int32_t opengl::t_shader_program::get_uniform_loc(const char* name) const { return (glGetUniformLocation(m_prog_id, name)); }
@@ -0,0 +1,26 @@
+#ifndef EIGENPHYSIKS_OPENGL_SHADER_HDR
+#define EIGENPHYSIKS_OPENGL_SHADER_HDR
+
+#include <cstdint>
+
+namespace opengl {
+	// vertex+fragment program; attribute locations are fixed by the sources
+	// via layout qualifiers, so only uniforms are looked up by name
+	struct t_shader_program {
+	public:
+		bool init(const char* vert_src, const char* frag_src);
+		void kill();
+
+		void enable() const;
+		void disable() const;
+
+		int32_t get_uniform_loc(const char* name) const;
+
+		bool is_valid() const { return (m_prog_id != 0); }
+
+	private:
+		uint32_t m_prog_id = 0;
+	};
+};
+
+#endif
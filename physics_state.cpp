@@ -1,34 +1,160 @@
+#include <cstdio>
+
+#include "frame_arena.hpp"
 #include "physics_state.hpp"
+#include "profiler.hpp"
+
+static constexpr size_t ATTACHMENT_CHUNK_SIZE = 4;
 
 void epiks::t_physics_state::init() {
 	constexpr float r = consts::WORLD_PARAMS.ground_plane_scale * 0.5f;
-	constexpr float a = (M_PI * 2.0f) / NUM_ARMS;
+	constexpr float a = (M_PI * 2.0f) / NUM_DEFAULT_ARMS;
+
+	epiks::t_spring_grid rope = {consts::ROPE_PARAMS, consts::SPRING_PARAMS, consts::WORLD_PARAMS};
+	epiks::t_rb_chain arm;
+
+	arm.add_piece(0.2f);
+	arm.add_piece(0.4f);
+	arm.add_piece(0.8f);
+	arm.add_piece(0.6f);
+	arm.add_piece(0.4f);
+	arm.add_piece(0.3f);
+	arm.set_goal_pos({0.0f, consts::WORLD_PARAMS.ground_plane_level + 10.0f, 0.0f}); // redundant
+
+	rope.add_anchor(consts::ROPE_ANCHOR);
+
+	const size_t rope_idx = add_grid(rope);
+
+	// every arm tracks the rope's tail
+	for (size_t i = 0; i < NUM_DEFAULT_ARMS; i++) {
+		arm.set_base_pos({std::cos(i * a) * r, consts::WORLD_PARAMS.ground_plane_level + 0.1f, std::sin(i * a) * r});
+		add_attachment({add_chain(arm), rope_idx, rope.get_tail_obj_idx(), 5.0f});
+	}
+
+	init_scene();
+}
+
+void epiks::t_physics_state::init_scene() {
+	init_schedule();
 
-	for (size_t i = 0; i < NUM_ARMS; i++) {
-		m_arms[i].add_piece(0.2f);
-		m_arms[i].add_piece(0.4f);
-		m_arms[i].add_piece(0.8f);
-		m_arms[i].add_piece(0.6f);
-		m_arms[i].add_piece(0.4f);
-		m_arms[i].add_piece(0.3f);
+	// no solve has run yet; start from the pose the pieces were built in
+	for (size_t i = 0; i < m_chains.size(); i++) {
+		epiks::t_rb_chain& chain = m_chains[i];
 
-		m_arms[i].set_base_pos({std::cos(i * a) * r, consts::WORLD_PARAMS.ground_plane_level + 0.1f, std::sin(i * a) * r});
-		m_arms[i].set_goal_pos({0.0f, consts::WORLD_PARAMS.ground_plane_level + 10.0f, 0.0f}); // redundant
+		chain.set_tail_pos(chain.get_base_pos() + chain.calc_tail_pos().cast<float>());
+
+		m_prev_tail_positions[i] = chain.get_tail_pos();
+		m_curr_tail_positions[i] = chain.get_tail_pos();
 	}
+}
+
+void epiks::t_physics_state::init_restored(uint64_t num_ticks, const t_pos3f* prev_tail_positions, const t_pos3f* curr_tail_positions) {
+	init_schedule();
 
-	m_rope.add_anchor(consts::ROPE_ANCHOR);
-	m_rope.add_springs();
+	m_prev_tail_positions.assign(prev_tail_positions, prev_tail_positions + m_chains.size());
+	m_curr_tail_positions.assign(curr_tail_positions, curr_tail_positions + m_chains.size());
+
+	// resume the multi-rate schedule at the same phase
+	m_num_ticks = num_ticks;
+}
+
+void epiks::t_physics_state::init_schedule() {
+	m_static_geometry.build();
+	m_spring_world.set_static_geometry(&m_static_geometry);
+
+	// goals only move when springs do, so a chain sub-step would re-solve
+	// toward the same target; faster chain rates run at the base rate
+	if (m_rates.chain_rate_hz > consts::SIM_STEP_RATE) {
+		std::fprintf(stderr, "[phys::%s] chain rate %uHz clamped to the base rate %uHz\n", __func__, m_rates.chain_rate_hz, consts::SIM_STEP_RATE);
+		m_rates.chain_rate_hz = consts::SIM_STEP_RATE;
+	}
+
+	m_chain_rate = {m_rates.chain_rate_hz, consts::SIM_STEP_RATE};
+	m_spring_rate = {m_rates.spring_rate_hz, consts::SIM_STEP_RATE};
+
+	m_prev_tail_positions.resize(m_chains.size());
+	m_curr_tail_positions.resize(m_chains.size());
 }
 
 void epiks::t_physics_state::step(float dt) {
-	const epiks::t_spring_grid_params& gp = m_rope.get_grid_params();
-	const epiks::t_point_object& po = m_rope.get_object((gp.num_links_x * gp.num_links_y) - 1); // tail
+	EIGENPHYSIKS_PROFILE_ZONE("step");
+
+	// per-tick temporaries from the previous step are dead by now; workers
+	// release theirs when their outermost arena scope closes
+	util::t_frame_arena::get_thread_arena().reset();
 
-	for (size_t i = 0; i < NUM_ARMS; i++) {
-		m_arms[i].solve(po.get_pos());
-		m_rope.add_pulling_acc((m_arms[i].get_tail_pos() - po.get_pos()) * 5.0f);
+	// goals are sampled when chains are due and held until their next update
+	if (m_chain_rate.is_due(m_num_ticks))
+		solve_chains();
+
+	const float phase = m_chain_rate.calc_phase(m_num_ticks);
+	const float spring_dt = m_spring_rate.calc_step_size(dt);
+
+	// springs that run slower than the base rate take one larger step
+	if (m_spring_rate.is_due(m_num_ticks)) {
+		for (uint32_t n = 0; n < m_spring_rate.get_num_substeps(); n++) {
+			// pulls are consumed by every spring update
+			apply_pulls(phase);
+			m_spring_world.update(spring_dt, m_thread_pool);
+		}
 	}
 
-	m_rope.update(dt);
+	m_num_ticks += 1;
 }
 
+void epiks::t_physics_state::solve_chains() {
+	EIGENPHYSIKS_PROFILE_ZONE("step::chains");
+
+	// chains are independent, solve them in parallel (one attachment per chain)
+	m_thread_pool.parallel_for(m_attachments.size(), ATTACHMENT_CHUNK_SIZE, [&](size_t i) {
+		const epiks::t_chain_attachment& ca = m_attachments[i];
+
+		m_chains[ca.chain_idx].solve(m_spring_world.get_pos(m_spring_world.get_obj_idx(ca.grid_idx, ca.obj_idx)));
+	});
+
+	for (size_t i = 0; i < m_chains.size(); i++) {
+		m_prev_tail_positions[i] = m_curr_tail_positions[i];
+		m_curr_tail_positions[i] = m_chains[i].get_tail_pos();
+	}
+}
+
+void epiks::t_physics_state::apply_pulls(float phase) {
+	for (const epiks::t_chain_attachment& ca: m_attachments) {
+		const size_t obj_idx = m_spring_world.get_obj_idx(ca.grid_idx, ca.obj_idx);
+
+		const t_pos3f& prev_tail_pos = m_prev_tail_positions[ca.chain_idx];
+		const t_pos3f& curr_tail_pos = m_curr_tail_positions[ca.chain_idx];
+		const t_pos3f  pull_tgt_pos  = m_rates.lerp_pulls? t_pos3f(prev_tail_pos + (curr_tail_pos - prev_tail_pos) * phase): curr_tail_pos;
+
+		m_spring_world.add_pulling_acc(obj_idx, (pull_tgt_pos - m_spring_world.get_pos(obj_idx)) * ca.pull_coeff);
+	}
+}
+
+
+const char* epiks::check_scene(const std::vector<t_spring_grid>& grids, const std::vector<t_rb_chain>& chains) {
+	// the world (and every consumer of it) assumes at least one object
+	if (grids.empty())
+		return "scene has no grid";
+
+	for (const t_spring_grid& grid: grids) {
+		const t_spring_grid_params& gp = grid.get_grid_params();
+
+		// sizes >= 1 and mass > 0 (NaN included) since restore divides by it
+		if (gp.num_links_x == 0 || gp.num_links_y == 0 || !(gp.link_mass > 0.0f))
+			return "every grid needs sizes >= 1 and mass > 0";
+		// rest positions are laid out relative to the first anchor
+		if (grid.get_num_anchors() == 0)
+			return "every grid needs an anchor";
+	}
+	for (const t_rb_chain& chain: chains) {
+		if (chain.get_num_pieces() == 0)
+			return "every chain needs a piece";
+
+		for (const t_rb_chain::t_piece& piece: chain.get_pieces()) {
+			if (!(piece.get_length() > 0.0f))
+				return "every piece needs a positive length";
+		}
+	}
+
+	return nullptr;
+}
@@ -1,33 +1,123 @@
 #ifndef EIGENPHYSIKS_STATE_HDR
 #define EIGENPHYSIKS_STATE_HDR
 
+#include <vector>
+
 #include "eigen_ik_solver.hpp"
-#include "spring_rope.hpp"
+#include "global_consts.hpp"
+#include "spring_grid.hpp"
+#include "spring_world.hpp"
+#include "static_geometry.hpp"
+#include "thread_pool.hpp"
+#include "tick_rate.hpp"
 #include "world_consts.hpp"
 
 namespace epiks {
+	// makes a chain track one grid object; the chain's goal is the object's
+	// position and the object is pulled toward the chain's end-effector
+	struct t_chain_attachment {
+		size_t chain_idx;
+		size_t grid_idx;
+		size_t obj_idx; // grid-space
+
+		float pull_coeff;
+	};
+
+
+	// per-subsystem update rates, in Hz; rounded by t_tick_rate to a whole
+	// number of base ticks (or sub-steps) per update; chains never run
+	// faster than the base rate
+	struct t_physics_rates {
+		uint32_t chain_rate_hz = consts::SIM_STEP_RATE;
+		uint32_t spring_rate_hz = consts::SIM_STEP_RATE;
+
+		// between chain updates pulls either target the last solved
+		// end-effector (hold) or blend toward it from the one before (lerp)
+		bool lerp_pulls = false;
+	};
+
+
 	struct t_physics_state {
 	public:
-		t_physics_state(): m_rope{consts::ROPE_PARAMS, consts::SPRING_PARAMS, consts::WORLD_PARAMS} {}
+		// rates must be set before init
+		void set_rates(const t_physics_rates& rates) { m_rates = rates; }
 
+		// builds the default (compiled-in) scene, then calls init_scene
 		void init();
+		// alternative to init for a state whose grids, chains and attachments
+		// were added directly, e.g. by a scene loader (see scene_loader.hpp)
+		void init_scene();
+		// alternative to init for a state whose grids, chains and attachments
+		// were filled in from a checkpoint (see checkpoint.hpp)
+		void init_restored(uint64_t num_ticks, const t_pos3f* prev_tail_positions, const t_pos3f* curr_tail_positions);
 		void kill() {}
+		// advances by one base tick of size dt (one 1/SIM_STEP_RATE period)
 		void step(float dt);
 
-		const epiks::t_spring_grid& get_rope() const { return m_rope; }
-		      epiks::t_spring_grid& get_rope()       { return m_rope; }
+		size_t add_grid(const epiks::t_spring_grid& grid) { return (m_spring_world.add_grid(grid)); }
+		size_t add_chain(const epiks::t_rb_chain& chain) { m_chains.push_back(chain); return (m_chains.size() - 1); }
+		size_t add_attachment(const epiks::t_chain_attachment& a) { m_attachments.push_back(a); return (m_attachments.size() - 1); }
+
+		size_t get_num_chains() const { return (m_chains.size()); }
+		size_t get_num_attachments() const { return (m_attachments.size()); }
+
+		const epiks::t_spring_world& get_spring_world() const { return m_spring_world; }
+		      epiks::t_spring_world& get_spring_world()       { return m_spring_world; }
+
+		const epiks::t_rb_chain& get_chain(size_t i) const { return m_chains[i]; }
+		      epiks::t_rb_chain& get_chain(size_t i)       { return m_chains[i]; }
+
+		const epiks::t_chain_attachment& get_attachment(size_t i) const { return m_attachments[i]; }
+
+		const util::t_tick_rate& get_chain_rate() const { return m_chain_rate; }
+		const util::t_tick_rate& get_spring_rate() const { return m_spring_rate; }
 
-		const epiks::t_rb_chain& get_arm(size_t i) const { return m_arms[i]; }
-		      epiks::t_rb_chain& get_arm(size_t i)       { return m_arms[i]; }
+		uint64_t get_num_ticks() const { return m_num_ticks; }
+
+		// end-effector positions the springs are pulled toward, see apply_pulls
+		const t_pos3f& get_prev_tail_pos(size_t chain_idx) const { return m_prev_tail_positions[chain_idx]; }
+		const t_pos3f& get_curr_tail_pos(size_t chain_idx) const { return m_curr_tail_positions[chain_idx]; }
+
+		// obstacles must be added before init, which builds the BVH
+		const epiks::t_static_geometry& get_static_geometry() const { return m_static_geometry; }
+		      epiks::t_static_geometry& get_static_geometry()       { return m_static_geometry; }
 
 	public:
-		static constexpr size_t NUM_ARMS = 6;
+		static constexpr size_t NUM_DEFAULT_ARMS = 6;
 
 	private:
-		epiks::t_spring_grid m_rope;
-		epiks::t_rb_chain m_arms[NUM_ARMS];
+		void init_schedule();
+
+		void solve_chains();
+		void apply_pulls(float phase);
+
+	private:
+		epiks::t_spring_world m_spring_world;
+
+		std::vector<epiks::t_rb_chain> m_chains;
+		std::vector<epiks::t_chain_attachment> m_attachments;
+
+		// end-effector positions after the previous and latest chain update
+		std::vector<t_pos3f> m_prev_tail_positions;
+		std::vector<t_pos3f> m_curr_tail_positions;
+
+		t_physics_rates m_rates;
+
+		util::t_tick_rate m_chain_rate;
+		util::t_tick_rate m_spring_rate;
+
+		// base ticks since init; the schedule is a pure function of it
+		uint64_t m_num_ticks = 0;
+
+		epiks::t_static_geometry m_static_geometry;
+		util::t_thread_pool m_thread_pool;
 	};
+
+
+	// invariants every loaded scene (text or binary) must satisfy before it
+	// is added to a t_physics_state; returns the first one that is violated,
+	// nullptr if none is
+	const char* check_scene(const std::vector<t_spring_grid>& grids, const std::vector<t_rb_chain>& chains);
 };
 
 #endif
-
@@ -0,0 +1,86 @@
+#include <cassert>
+#include <chrono>
+
+#include "physics_thread.hpp"
+#include "global_consts.hpp"
+#include "system_timer.hpp"
+
+void epiks::t_physics_thread::start(const std::function<void()>& tick_func) {
+	assert(!m_running);
+
+	m_tick_func = tick_func;
+	m_running = true;
+	m_thread = std::thread([this]() { loop(); });
+}
+
+void epiks::t_physics_thread::stop() {
+	if (!m_running)
+		return;
+
+	m_running = false;
+	m_thread.join();
+}
+
+
+void epiks::t_physics_thread::loop() {
+	typedef std::chrono::steady_clock t_clock;
+
+	util::t_system_timer tick_timer;
+
+	t_clock::time_point next_tick_time = t_clock::now();
+
+	while (m_running) {
+		// sampled once, the UI thread may toggle it at any point below
+		if (m_paused.load()) {
+			if (consume_single_step()) {
+				run_tick(tick_timer);
+				continue;
+			}
+
+			// while paused the deadline keeps moving so no debt builds up
+			next_tick_time += std::chrono::nanoseconds(consts::SIM_STEP_TIME_NS);
+			std::this_thread::sleep_until(next_tick_time);
+			continue;
+		}
+
+		const t_clock::time_point curr_time = t_clock::now();
+
+		if (curr_time < next_tick_time) {
+			std::this_thread::sleep_until(next_tick_time);
+			continue;
+		}
+
+		// every tick whose deadline has passed is owed, including this one
+		uint64_t debt_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(curr_time - next_tick_time).count() + consts::SIM_STEP_TIME_NS;
+		uint32_t num_steps = m_catchup_policy.calc_num_steps(debt_ns, consts::SIM_STEP_TIME_NS, m_catchup_stats);
+
+		// move the deadline forward past whatever debt was dropped
+		next_tick_time = curr_time - std::chrono::nanoseconds(debt_ns - consts::SIM_STEP_TIME_NS);
+
+		for (; num_steps > 0 && m_running; num_steps--) {
+			run_tick(tick_timer);
+			next_tick_time += std::chrono::nanoseconds(consts::SIM_STEP_TIME_NS);
+		}
+	}
+}
+
+bool epiks::t_physics_thread::consume_single_step() {
+	uint32_t num_steps = m_single_steps.load();
+
+	// decrement only if nonzero; the UI thread may add steps concurrently
+	while (num_steps != 0) {
+		if (m_single_steps.compare_exchange_weak(num_steps, num_steps - 1))
+			return true;
+	}
+
+	return false;
+}
+
+void epiks::t_physics_thread::run_tick(util::t_system_timer& tick_timer) {
+	// execute one physics-timestep (tick/update)
+	tick_timer.tick_time();
+	m_tick_func();
+
+	m_tick_time_ns += tick_timer.tock_time();
+	m_num_ticks += 1;
+}
@@ -0,0 +1,56 @@
+#ifndef EIGENPHYSIKS_PHYSICS_THREAD_HDR
+#define EIGENPHYSIKS_PHYSICS_THREAD_HDR
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+#include "catchup_policy.hpp"
+#include "system_timer.hpp"
+
+namespace epiks {
+	// runs a tick-function at SIM_STEP_RATE on a dedicated thread, decoupled
+	// from rendering; ticks are paced by the steady clock, not by frames
+	struct t_physics_thread {
+	public:
+		~t_physics_thread() { stop(); }
+
+		void start(const std::function<void()>& tick_func);
+		void stop();
+
+		// must be set before start
+		void set_catchup_policy(const util::t_catchup_policy& p) { m_catchup_policy = p; }
+
+		void toggle_pause() { m_paused = !m_paused; }
+		void add_single_step() { m_single_steps += 1; }
+
+		uint64_t get_num_ticks() const { return m_num_ticks; }
+		uint64_t get_tick_time_ns() const { return m_tick_time_ns; }
+
+		util::t_catchup_stats& get_catchup_stats() { return m_catchup_stats; }
+
+		bool is_running() const { return m_running; }
+
+	private:
+		void loop();
+		bool consume_single_step();
+		void run_tick(util::t_system_timer& tick_timer);
+
+	private:
+		std::thread m_thread;
+		std::function<void()> m_tick_func;
+
+		util::t_catchup_policy m_catchup_policy;
+		util::t_catchup_stats m_catchup_stats;
+
+		std::atomic<bool> m_running = {false};
+		std::atomic<bool> m_paused = {false};
+
+		std::atomic<uint32_t> m_single_steps = {0};
+
+		std::atomic<uint64_t> m_num_ticks = {0}; // total number of ticks executed
+		std::atomic<uint64_t> m_tick_time_ns = {0}; // total time (ns) spent in ticks
+	};
+};
+
+#endif
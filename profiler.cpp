@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <cassert>
+
+#include "profiler.hpp"
+
+util::t_prof_zone::t_prof_zone(const char* name): m_name(name) {
+	m_id = t_profiler::get_instance().register_zone(name);
+}
+
+
+
+util::t_profiler& util::t_profiler::get_instance() {
+	static t_profiler profiler;
+	return profiler;
+}
+
+uint32_t util::t_profiler::register_zone(const char* name) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// checked in every build; zone ids index fixed-size per-thread tables
+	if (m_zone_names.size() == OVERFLOW_ZONE_ID) {
+		std::fprintf(stderr, "[prof::%s] more than %u zones, \"%s\" is counted as (overflow)\n", __func__, OVERFLOW_ZONE_ID, name);
+		return OVERFLOW_ZONE_ID;
+	}
+
+	m_zone_names.push_back(name);
+	return (m_zone_names.size() - 1);
+}
+
+util::t_profiler::t_thread_state& util::t_profiler::get_thread_state() {
+	static thread_local t_thread_state* state = nullptr;
+
+	if (state != nullptr)
+		return *state;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_thread_states.push_back(state = new t_thread_state());
+	return *state;
+}
+
+uint32_t util::t_profiler::find_node(uint32_t parent_idx, uint32_t zone_id) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for (size_t i = 1; i < m_node_infos.size(); i++) {
+		if (m_node_infos[i].parent_idx == parent_idx && m_node_infos[i].zone_id == zone_id)
+			return i;
+	}
+
+	// never fall back to the parent; its time already includes this zone's
+	if (zone_id == OVERFLOW_ZONE_ID)
+		return OVERFLOW_NODE_IDX;
+
+	if (m_node_infos.size() == MAX_NODES) {
+		if (!m_overflowed)
+			std::fprintf(stderr, "[prof::%s] more than %u zone-tree nodes, the rest are counted as (overflow)\n", __func__, MAX_NODES);
+
+		m_overflowed = true;
+		return OVERFLOW_NODE_IDX;
+	}
+
+	m_node_infos.push_back({parent_idx, zone_id});
+	return (m_node_infos.size() - 1);
+}
+
+
+uint32_t util::t_profiler::enter_zone(const t_prof_zone& zone) {
+	t_thread_state& ts = get_thread_state();
+
+	const uint32_t parent_idx = ts.node_stack[ts.stack_size - 1];
+
+	uint16_t& node_idx = ts.node_cache[parent_idx][zone.get_id()];
+
+	// only the first entry per {thread, parent, zone} takes the lock
+	if (node_idx == 0)
+		node_idx = find_node(parent_idx, zone.get_id());
+
+	assert(ts.stack_size < MAX_NODES);
+	ts.node_stack[ts.stack_size++] = node_idx;
+	return node_idx;
+}
+
+void util::t_profiler::leave_zone(uint32_t node_idx, uint64_t time_ns) {
+	t_thread_state& ts = get_thread_state();
+	t_node_stats& ns = ts.node_stats[node_idx];
+
+	ts.stack_size -= 1;
+
+	ns.count.fetch_add(1, std::memory_order_relaxed);
+	ns.sum_ns.fetch_add(time_ns, std::memory_order_relaxed);
+	ns.hist[calc_bucket(time_ns)].fetch_add(1, std::memory_order_relaxed);
+
+	if (time_ns > ns.max_ns.load(std::memory_order_relaxed))
+		ns.max_ns.store(time_ns, std::memory_order_relaxed);
+}
+
+
+uint32_t util::t_profiler::calc_bucket(uint64_t time_ns) {
+	if (time_ns < NUM_SUB_BUCKETS)
+		return time_ns;
+
+	// log-linear; NUM_SUB_BUCKETS linear steps per power of two
+	const uint32_t exp = 63 - __builtin_clzll(time_ns);
+	const uint32_t sub = (time_ns >> (exp - 2)) & (NUM_SUB_BUCKETS - 1);
+
+	return (std::min((exp - 1) * NUM_SUB_BUCKETS + sub, NUM_BUCKETS - 1));
+}
+
+uint64_t util::t_profiler::calc_bucket_time(uint32_t bucket) {
+	if (bucket < NUM_SUB_BUCKETS)
+		return bucket;
+
+	const uint32_t exp = (bucket / NUM_SUB_BUCKETS) + 1;
+	const uint32_t sub = (bucket % NUM_SUB_BUCKETS);
+
+	// buckets of width one have no middle
+	if (exp < 3)
+		return ((NUM_SUB_BUCKETS + sub) << (exp - 2));
+
+	// middle of the bucket's range
+	return (((uint64_t(NUM_SUB_BUCKETS + sub) << 1) + 1) << (exp - 3));
+}
+
+
+void util::t_profiler::output_stats(FILE* out) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	const size_t num_nodes = m_node_infos.size();
+
+	std::vector<uint64_t> counts(num_nodes, 0);
+	std::vector<uint64_t> sums(num_nodes, 0);
+	std::vector<uint64_t> maxs(num_nodes, 0);
+	std::vector<uint64_t> hists(num_nodes * NUM_BUCKETS, 0);
+
+	// merge (and reset) all per-thread statistics
+	for (t_thread_state* ts: m_thread_states) {
+		for (size_t i = 1; i < num_nodes; i++) {
+			t_node_stats& ns = ts->node_stats[i];
+
+			counts[i] += ns.count.exchange(0, std::memory_order_relaxed);
+			sums[i] += ns.sum_ns.exchange(0, std::memory_order_relaxed);
+			maxs[i] = std::max(maxs[i], uint64_t(ns.max_ns.exchange(0, std::memory_order_relaxed)));
+
+			for (uint32_t b = 0; b < NUM_BUCKETS; b++) {
+				hists[i * NUM_BUCKETS + b] += ns.hist[b].exchange(0, std::memory_order_relaxed);
+			}
+		}
+	}
+
+	const auto calc_percentile = [&](size_t node_idx, float frac) {
+		const uint64_t rank = counts[node_idx] * frac;
+
+		uint64_t sum = 0;
+
+		for (uint32_t b = 0; b < NUM_BUCKETS; b++) {
+			if ((sum += hists[node_idx * NUM_BUCKETS + b]) > rank)
+				return (std::min(calc_bucket_time(b), maxs[node_idx]));
+		}
+
+		return maxs[node_idx];
+	};
+
+	const auto output_node = [&](size_t node_idx, size_t depth, const auto& output_func) -> void {
+		if (counts[node_idx] != 0) {
+			std::fprintf(out, "[prof::output_stats] %*s%-*s n=%-7lu mean=%9.2fus p50=%9.2fus p99=%9.2fus max=%9.2fus\n",
+				int(depth * 2), "",
+				int(32 - depth * 2), get_zone_name(m_node_infos[node_idx].zone_id),
+				(unsigned long) counts[node_idx],
+				(sums[node_idx] * 1e-3) / counts[node_idx],
+				calc_percentile(node_idx, 0.50f) * 1e-3,
+				calc_percentile(node_idx, 0.99f) * 1e-3,
+				maxs[node_idx] * 1e-3
+			);
+		}
+
+		for (size_t i = 1; i < num_nodes; i++) {
+			if (m_node_infos[i].parent_idx == node_idx)
+				output_func(i, depth + 1, output_func);
+		}
+	};
+
+	for (size_t i = 1; i < num_nodes; i++) {
+		if (m_node_infos[i].parent_idx == 0)
+			output_node(i, 0, output_node);
+	}
+}
@@ -0,0 +1,151 @@
+#ifndef EIGENPHYSIKS_PROFILER_HDR
+#define EIGENPHYSIKS_PROFILER_HDR
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+#include "system_timer.hpp"
+#include "trace_writer.hpp"
+
+namespace util {
+	// statically allocated name for a timed code region; regions nest, and
+	// the same zone entered under different parents is reported separately
+	struct t_prof_zone {
+	public:
+		t_prof_zone(const char* name);
+
+		const char* get_name() const { return m_name; }
+		uint32_t get_id() const { return m_id; }
+
+	private:
+		const char* m_name;
+		uint32_t m_id;
+	};
+
+
+	struct t_profiler {
+	public:
+		static constexpr uint32_t MAX_ZONES = 64;
+		static constexpr uint32_t MAX_NODES = 256; // (parent-node, zone) pairs
+		static constexpr uint32_t NUM_SUB_BUCKETS = 4; // per power of two
+		static constexpr uint32_t NUM_BUCKETS = 40 * NUM_SUB_BUCKETS; // up to 2^40 ns
+
+		// zones registered past MAX_ZONES, and nodes past MAX_NODES, are all
+		// charged to this one top-level node (and zone) instead
+		static constexpr uint32_t OVERFLOW_ZONE_ID = MAX_ZONES - 1;
+		static constexpr uint32_t OVERFLOW_NODE_IDX = 1;
+
+		// statistics for one node of the zone-tree on one thread; only the
+		// owning thread adds to them, the reporting thread drains them
+		struct t_node_stats {
+			std::atomic<uint64_t> count = {0};
+			std::atomic<uint64_t> sum_ns = {0};
+			std::atomic<uint64_t> max_ns = {0};
+			std::atomic<uint32_t> hist[NUM_BUCKETS] = {};
+		};
+
+		struct t_thread_state {
+			t_node_stats node_stats[MAX_NODES];
+
+			// child-node index per {parent-node, zone}, 0 if not yet looked up
+			uint16_t node_cache[MAX_NODES][MAX_ZONES] = {};
+			uint16_t node_stack[MAX_NODES] = {0};
+			uint32_t stack_size = 1;
+		};
+
+	public:
+		static t_profiler& get_instance();
+
+		uint32_t register_zone(const char* name);
+
+		uint32_t enter_zone(const t_prof_zone& zone);
+		void leave_zone(uint32_t node_idx, uint64_t time_ns);
+
+		// prints {count,mean,p50,p99,max} per zone since the previous call
+		void output_stats(FILE* out);
+
+		// log-linear histogram buckets; also used for telemetry values
+		static uint32_t calc_bucket(uint64_t time_ns);
+		static uint64_t calc_bucket_time(uint32_t bucket);
+
+	private:
+		t_thread_state& get_thread_state();
+
+		uint32_t find_node(uint32_t parent_idx, uint32_t zone_id);
+
+		const char* get_zone_name(uint32_t zone_id) const { return ((zone_id == OVERFLOW_ZONE_ID)? "(overflow)": m_zone_names[zone_id]); }
+
+	private:
+		struct t_node_info {
+			uint32_t parent_idx;
+			uint32_t zone_id;
+		};
+
+		std::mutex m_mutex;
+
+		// every thread that ever entered a zone; states are never freed
+		std::vector<t_thread_state*> m_thread_states;
+		std::vector<const char*> m_zone_names;
+
+		// node 0 is the (unnamed) root, node 1 the overflow node under it
+		std::vector<t_node_info> m_node_infos = {{0, 0}, {0, OVERFLOW_ZONE_ID}};
+
+		bool m_overflowed = false;
+	};
+
+
+	// times its own lifetime against a zone via t_system_timer, and also
+	// records it as a trace event while the trace writer is enabled
+	struct t_scoped_timer {
+	public:
+		t_scoped_timer(const t_prof_zone& zone): m_zone(zone), m_node_idx(t_profiler::get_instance().enter_zone(zone)) { m_timer.tick_time(); }
+		~t_scoped_timer() {
+			const uint64_t time_ns = m_timer.tock_time();
+
+			t_profiler::get_instance().leave_zone(m_node_idx, time_ns);
+
+			if (!t_trace_writer::get_instance().is_enabled())
+				return;
+
+			t_trace_writer::get_instance().add_event(m_zone.get_name(), m_timer.tick_stamp(), time_ns, m_arg_name, m_arg_value);
+		}
+
+		// attaches a value (e.g. an iteration count) to the trace event
+		void set_arg(const char* name, int64_t value) {
+			m_arg_name = name;
+			m_arg_value = value;
+		}
+
+	private:
+		const t_prof_zone& m_zone;
+
+		t_system_timer m_timer;
+		uint32_t m_node_idx;
+
+		const char* m_arg_name = nullptr;
+		int64_t m_arg_value = 0;
+	};
+
+	struct t_null_timer {
+		void set_arg(const char*, int64_t) {}
+	};
+};
+
+
+#define EIGENPHYSIKS_PROFILE_CONCAT_(a, b) a ## b
+#define EIGENPHYSIKS_PROFILE_CONCAT(a, b) EIGENPHYSIKS_PROFILE_CONCAT_(a, b)
+
+// _VAR variant names the timer so set_arg can be called on it
+#ifndef EIGENPHYSIKS_NO_PROFILER
+#define EIGENPHYSIKS_PROFILE_ZONE_VAR(var, name)                                                 \
+	static const util::t_prof_zone EIGENPHYSIKS_PROFILE_CONCAT(prof_zone_, __LINE__)(name);      \
+	util::t_scoped_timer var(EIGENPHYSIKS_PROFILE_CONCAT(prof_zone_, __LINE__));
+#else
+#define EIGENPHYSIKS_PROFILE_ZONE_VAR(var, name) util::t_null_timer var;
+#endif
+
+#define EIGENPHYSIKS_PROFILE_ZONE(name) EIGENPHYSIKS_PROFILE_ZONE_VAR(EIGENPHYSIKS_PROFILE_CONCAT(prof_timer_, __LINE__), name)
+
+#endif
@@ -2,12 +2,75 @@
 #include <GL/gl.h>
 #include <GL/freeglut.h>
 
+#include <algorithm>
+#include <array>
+
 #include "render_state.hpp"
-#include "physics_state.hpp"
-#include "eigen_ik_solver.hpp"
+#include "state_snapshot.hpp"
+#include "eigen_math.hpp"
 #include "global_consts.hpp"
+#include "profiler.hpp"
+#include "world_consts.hpp"
+
+// lit like the fixed-function pipeline with its default material (ambient
+// 0.2, diffuse 0.8, no specular) and global ambient term, but per-fragment
+static const char* ARM_VERT_SHADER_SRC = R"(
+	#version 330 core
+
+	layout(location = 0) in vec3 a_vert_pos;
+	layout(location = 1) in vec3 a_vert_nrm;
+	layout(location = 2) in mat4 a_inst_mat;
+
+	uniform mat4 u_proj_mat;
+	uniform mat4 u_view_mat;
+
+	out vec3 v_world_pos;
+	out vec3 v_world_nrm;
+
+	void main() {
+		mat3 m = mat3(a_inst_mat);
+		// cofactor matrix, keeps normals perpendicular under non-uniform scale
+		mat3 c = mat3(cross(m[1], m[2]), cross(m[2], m[0]), cross(m[0], m[1]));
+		vec4 p = a_inst_mat * vec4(a_vert_pos, 1.0);
+
+		v_world_pos = p.xyz;
+		v_world_nrm = c * a_vert_nrm;
+
+		gl_Position = u_proj_mat * (u_view_mat * p);
+	}
+)";
+
+static const char* ARM_FRAG_SHADER_SRC = R"(
+	#version 330 core
+
+	uniform vec4 u_light_pos[2];
+	uniform vec4 u_light_ambi[2];
+	uniform vec4 u_light_diff[2];
+
+	in vec3 v_world_pos;
+	in vec3 v_world_nrm;
+
+	out vec4 f_color;
+
+	void main() {
+		const vec3 mat_ambi = vec3(0.2);
+		const vec3 mat_diff = vec3(0.8);
+
+		vec3 n = normalize(v_world_nrm);
+		vec3 c = vec3(0.2) * mat_ambi;
+
+		for (int i = 0; i < 2; i++) {
+			vec3 l = normalize(u_light_pos[i].xyz - v_world_pos * u_light_pos[i].w);
+
+			c += u_light_ambi[i].rgb * mat_ambi;
+			c += u_light_diff[i].rgb * mat_diff * max(dot(n, l), 0.0);
+		}
+
+		f_color = vec4(c, 1.0);
+	}
+)";
 
-void opengl::t_render_state::init(const epiks::t_physics_state& ps) {
+void opengl::t_render_state::init(const epiks::t_state_snapshot& ss) {
 	{
 		glEnable(GL_LIGHTING);
 		glEnable(GL_DEPTH_TEST);
@@ -59,9 +122,9 @@ void opengl::t_render_state::init(const epiks::t_physics_state& ps) {
 
 	{
 		constexpr float scale = 0.15f;
-		constexpr float angle = (2.0f * M_PI) / num_cone_divs;
+		constexpr uint32_t lod_cone_divs[2] = {num_cone_divs, num_lod_cone_divs};
 
-		assert(num_cone_vbo_bytes == (num_cone_elems * cone_vbo_elem_size));
+		assert(num_cone_vbo_bytes == ((num_cone_elems + num_lod_cone_elems) * cone_vbo_elem_size));
 
 		glGenBuffers(1, &m_cone_vbo_id);
 		glBindBuffer(GL_ARRAY_BUFFER, m_cone_vbo_id);
@@ -73,34 +136,40 @@ void opengl::t_render_state::init(const epiks::t_physics_state& ps) {
 		const t_pos3f v1 =  consts::WORLD_AXES[consts::AXIS_IDX_Z];
 		const t_vec3f n0 = -consts::WORLD_AXES[consts::AXIS_IDX_Z];
 
-		for (uint32_t i = 0; i < num_cone_divs; i++) {
-			// generate vertices in counter-clockwise order
-			const t_pos3f v3 = {scale * std::cos((i    ) * angle), scale * std::sin((i    ) * angle), 0.0f};
-			const t_pos3f v4 = {scale * std::cos((i + 1) * angle), scale * std::sin((i + 1) * angle), 0.0f};
-			const t_vec3f n1 = (((v4 - v3).normalized()).cross(((v1 - v3).normalized()))).normalized();
+		for (uint32_t lod = 0, lod_offset = 0; lod < 2; lod_offset += lod_cone_divs[lod++] * num_cone_div_floats) {
+			float* cone_vbo_ptr = m_cone_vbo_ptr + lod_offset;
 
-			// cone side-face slice (three elements, 3 * (sizeof(t_pos3f) + sizeof(t_vec3f)) bytes, 3 * 6 floats)
-			for (uint32_t j = 0; j < 3; j++) {
-				m_cone_vbo_ptr[i * num_cone_div_floats + (0 + j)] = v3[j];
-				m_cone_vbo_ptr[i * num_cone_div_floats + (3 + j)] = n1[j];
+			const float angle = (2.0f * M_PI) / lod_cone_divs[lod];
 
-				m_cone_vbo_ptr[i * num_cone_div_floats + (6 + j)] = v4[j];
-				m_cone_vbo_ptr[i * num_cone_div_floats + (9 + j)] = n1[j];
+			for (uint32_t i = 0; i < lod_cone_divs[lod]; i++) {
+				// generate vertices in counter-clockwise order
+				const t_pos3f v3 = {scale * std::cos((i    ) * angle), scale * std::sin((i    ) * angle), 0.0f};
+				const t_pos3f v4 = {scale * std::cos((i + 1) * angle), scale * std::sin((i + 1) * angle), 0.0f};
+				const t_vec3f n1 = (((v4 - v3).normalized()).cross(((v1 - v3).normalized()))).normalized();
 
-				m_cone_vbo_ptr[i * num_cone_div_floats + (12 + j)] = v1[j];
-				m_cone_vbo_ptr[i * num_cone_div_floats + (15 + j)] = n1[j];
-			}
+				// cone side-face slice (three elements, 3 * (sizeof(t_pos3f) + sizeof(t_vec3f)) bytes, 3 * 6 floats)
+				for (uint32_t j = 0; j < 3; j++) {
+					cone_vbo_ptr[i * num_cone_div_floats + (0 + j)] = v3[j];
+					cone_vbo_ptr[i * num_cone_div_floats + (3 + j)] = n1[j];
+
+					cone_vbo_ptr[i * num_cone_div_floats + (6 + j)] = v4[j];
+					cone_vbo_ptr[i * num_cone_div_floats + (9 + j)] = n1[j];
+
+					cone_vbo_ptr[i * num_cone_div_floats + (12 + j)] = v1[j];
+					cone_vbo_ptr[i * num_cone_div_floats + (15 + j)] = n1[j];
+				}
 
-			// cone base-cap slice (three elements, 3 * (sizeof(t_pos3f) + sizeof(t_vec3f)) bytes, 3 * 6 floats)
-			for (uint32_t j = 0; j < 3; j++) {
-				m_cone_vbo_ptr[i * num_cone_div_floats + (18 + j)] = v0[j];
-				m_cone_vbo_ptr[i * num_cone_div_floats + (21 + j)] = n0[j];
+				// cone base-cap slice (three elements, 3 * (sizeof(t_pos3f) + sizeof(t_vec3f)) bytes, 3 * 6 floats)
+				for (uint32_t j = 0; j < 3; j++) {
+					cone_vbo_ptr[i * num_cone_div_floats + (18 + j)] = v0[j];
+					cone_vbo_ptr[i * num_cone_div_floats + (21 + j)] = n0[j];
 
-				m_cone_vbo_ptr[i * num_cone_div_floats + (24 + j)] = v4[j];
-				m_cone_vbo_ptr[i * num_cone_div_floats + (27 + j)] = n0[j];
+					cone_vbo_ptr[i * num_cone_div_floats + (24 + j)] = v4[j];
+					cone_vbo_ptr[i * num_cone_div_floats + (27 + j)] = n0[j];
 
-				m_cone_vbo_ptr[i * num_cone_div_floats + (30 + j)] = v3[j];
-				m_cone_vbo_ptr[i * num_cone_div_floats + (33 + j)] = n0[j];
+					cone_vbo_ptr[i * num_cone_div_floats + (30 + j)] = v3[j];
+					cone_vbo_ptr[i * num_cone_div_floats + (33 + j)] = n0[j];
+				}
 			}
 		}
 
@@ -109,18 +178,151 @@ void opengl::t_render_state::init(const epiks::t_physics_state& ps) {
 	}
 
 	{
-		const epiks::t_spring_grid& rope = ps.get_rope();
+		m_num_arm_insts = 0;
+
+		m_chain_inst_offsets.resize(ss.get_num_chains());
+		m_chain_draw_offsets.resize(ss.get_num_chains());
+		m_chain_lods.resize(ss.get_num_chains());
+
+		for (size_t i = 0; i < ss.get_num_chains(); i++) {
+			m_chain_inst_offsets[i] = m_num_arm_insts;
+			m_num_arm_insts += (ss.chains[i].num_pieces + 1);
+		}
+
+		m_arm_inst_mats.resize(m_num_arm_insts);
+
+		glGenVertexArrays(1, &m_arm_vao_id);
+		glBindVertexArray(m_arm_vao_id);
+
+		glBindBuffer(GL_ARRAY_BUFFER, m_cone_vbo_id);
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, cone_vbo_elem_size, cone_vbo_vertex_offset);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, cone_vbo_elem_size, cone_vbo_normal_offset);
+
+		// contents are replaced (orphaned) every frame
+		glGenBuffers(1, &m_arm_inst_vbo_id);
+		glBindBuffer(GL_ARRAY_BUFFER, m_arm_inst_vbo_id);
+		glBufferData(GL_ARRAY_BUFFER, std::max(m_num_arm_insts, 1u) * arm_inst_elem_size, nullptr, GL_STREAM_DRAW);
+
+		// a mat4 attribute occupies four consecutive vec4 locations
+		for (uint32_t j = 0; j < 4; j++) {
+			glEnableVertexAttribArray(2 + j);
+			glVertexAttribPointer(2 + j, 4, GL_FLOAT, GL_FALSE, arm_inst_elem_size, reinterpret_cast<void*>(j * sizeof(float) * 4));
+			glVertexAttribDivisor(2 + j, 1);
+		}
+
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		if (!m_arm_shader.init(ARM_VERT_SHADER_SRC, ARM_FRAG_SHADER_SRC))
+			exit(1);
+
+		m_arm_proj_mat_loc = m_arm_shader.get_uniform_loc("u_proj_mat");
+		m_arm_view_mat_loc = m_arm_shader.get_uniform_loc("u_view_mat");
+		m_arm_light_pos_loc = m_arm_shader.get_uniform_loc("u_light_pos");
+		m_arm_light_ambi_loc = m_arm_shader.get_uniform_loc("u_light_ambi");
+		m_arm_light_diff_loc = m_arm_shader.get_uniform_loc("u_light_diff");
+	}
+
+	{
+		const uint32_t num_tiles = (ss.get_num_objects() + rope_tile_size - 1) / rope_tile_size;
+
+		// coarse level merges every odd object into its even neighbour along
+		// the fastest-varying grid axis, never across a row or grid boundary
+		std::vector<uint32_t> coarse_indices(ss.get_num_objects());
 
+		for (size_t g = 0, obj_offset = 0; g < ss.grid_tail_indices.size(); g++) {
+			const uint32_t num_objects = ss.grid_tail_indices[g] + 1 - obj_offset;
+
+			// grids are contiguous; springs link x-neighbours (+1) and, unless
+			// the grid is a single line, y-neighbours (+row length)
+			uint32_t row_len = 1;
+
+			for (size_t i = 0; i < ss.get_num_springs(); i++) {
+				const uint32_t lhs = ss.spring_indices[i * 2 + 0];
+				const uint32_t rhs = ss.spring_indices[i * 2 + 1];
+
+				if (lhs >= obj_offset && lhs < (obj_offset + num_objects))
+					row_len = std::max(row_len, rhs - lhs);
+			}
+
+			// a single line (rope or one row) is paired along its length
+			if (row_len == 1)
+				row_len = num_objects;
+
+			for (uint32_t j = 0; j < num_objects; j++) {
+				coarse_indices[obj_offset + j] = obj_offset + (j / row_len) * row_len + ((j % row_len) & ~1u);
+			}
+
+			obj_offset += num_objects;
+		}
+
+		// {tile, lhs, rhs} per spring, full and coarse
+		std::vector<uint32_t> tile_springs[2];
+
+		for (size_t i = 0; i < ss.get_num_springs(); i++) {
+			const uint32_t lhs = ss.spring_indices[i * 2 + 0];
+			const uint32_t rhs = ss.spring_indices[i * 2 + 1];
+
+			tile_springs[LOD_FULL].insert(tile_springs[LOD_FULL].end(), {lhs / rope_tile_size, lhs, rhs});
+
+			if (coarse_indices[lhs] != coarse_indices[rhs])
+				tile_springs[LOD_COARSE].insert(tile_springs[LOD_COARSE].end(), {lhs / rope_tile_size, coarse_indices[lhs], coarse_indices[rhs]});
+		}
+
+		m_rope_indices.clear();
+		m_rope_tiles.assign(num_tiles, {{0, 0}, {0, 0}});
+		m_rope_tile_lods.assign(num_tiles, LOD_FULL);
+
+		for (uint32_t lod = LOD_FULL; lod <= LOD_COARSE; lod++) {
+			std::vector<std::array<uint32_t, 3>> springs(tile_springs[lod].size() / 3);
+
+			for (size_t i = 0; i < springs.size(); i++) {
+				springs[i] = {tile_springs[lod][i * 3 + 0], tile_springs[lod][i * 3 + 1], tile_springs[lod][i * 3 + 2]};
+			}
+
+			// group by tile; coarse springs can collapse onto the same pair
+			std::sort(springs.begin(), springs.end());
+			springs.erase(std::unique(springs.begin(), springs.end()), springs.end());
+
+			for (const std::array<uint32_t, 3>& spring: springs) {
+				t_rope_tile& tile = m_rope_tiles[spring[0]];
+
+				if (tile.index_counts[lod] == 0)
+					tile.index_offsets[lod] = m_rope_indices.size();
+
+				tile.index_counts[lod] += 2;
+
+				m_rope_indices.push_back(spring[1]);
+				m_rope_indices.push_back(spring[2]);
+			}
+		}
+
+		m_num_rope_verts = ss.get_num_objects();
+		m_num_rope_indices = m_rope_indices.size();
+		m_rope_vbo_region = 0;
+
+		std::fill(m_rope_vbo_fences, m_rope_vbo_fences + num_rope_vbo_regions, nullptr);
+
+		// every object once per region; springs (lines) index into a region
 		glGenBuffers(1, &m_rope_vbo_id);
 		glBindBuffer(GL_ARRAY_BUFFER, m_rope_vbo_id);
-		glBufferStorage(GL_ARRAY_BUFFER, rope.get_num_springs() * 2 * rope_vbo_elem_size, nullptr, rope_vbo_flag_bits);
+		glBufferStorage(GL_ARRAY_BUFFER, std::max(m_num_rope_verts, 1u) * num_rope_vbo_regions * rope_vbo_elem_size, nullptr, rope_vbo_flag_bits);
 
-		m_rope_vbo_ptr = reinterpret_cast<float*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, rope.get_num_springs() * 2 * rope_vbo_elem_size, rope_vbo_flag_bits));
+		m_rope_vbo_ptr = reinterpret_cast<float*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, std::max(m_num_rope_verts, 1u) * num_rope_vbo_regions * rope_vbo_elem_size, rope_vbo_flag_bits));
 
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		// connectivity is static, so the index buffer never changes
+		glGenBuffers(1, &m_rope_ibo_id);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_rope_ibo_id);
+		glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, std::max(m_num_rope_indices, 1u) * sizeof(uint32_t), m_rope_indices.data(), 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	}
 
-	m_quadric_obj = gluNewQuadric();
+	if (!m_debug_draw.init())
+		exit(1);
 }
 
 void opengl::t_render_state::kill() {
@@ -135,9 +337,20 @@ void opengl::t_render_state::kill() {
 		glUnmapBuffer(GL_ARRAY_BUFFER);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 		glDeleteBuffers(1, &m_rope_vbo_id);
+		glDeleteBuffers(1, &m_rope_ibo_id);
+
+		for (GLsync& fence: m_rope_vbo_fences) {
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+
+		glDeleteVertexArrays(1, &m_arm_vao_id);
+		glDeleteBuffers(1, &m_arm_inst_vbo_id);
 	}
 
-	gluDeleteQuadric(m_quadric_obj);
+	m_arm_shader.kill();
+
+	m_debug_draw.kill();
 }
 
 
@@ -148,11 +361,8 @@ void opengl::t_render_state::setup_camera() {
 	m_opengl_camera.set_gl_view_mat();
 }
 
-void opengl::t_render_state::setup_lights(const epiks::t_physics_state& ps) {
-	const epiks::t_spring_grid& rope = ps.get_rope();
-	const epiks::t_point_object& tail = rope.get_object(rope.get_num_springs());
-
-	const t_pos3f& tp = tail.get_pos();
+void opengl::t_render_state::setup_lights(const epiks::t_state_snapshot& ss) {
+	const t_pos3f& tp = ss.obj_positions[ss.grid_tail_indices[0]];
 
 	m_opengl_lights[0].set_position(0.0f, consts::WORLD_PARAMS.ground_plane_level + 1.0f, 0.0f, 1.0f);
 	m_opengl_lights[0].set_gl_state();
@@ -161,16 +371,18 @@ void opengl::t_render_state::setup_lights(const epiks::t_physics_state& ps) {
 	m_opengl_lights[1].set_gl_state();
 }
 
-void opengl::t_render_state::swap_buffers() const {
-	glutSwapBuffers();
-	glutPostRedisplay();
-}
+void opengl::t_render_state::swap_buffers() const { glutSwapBuffers(); }
+void opengl::t_render_state::post_redisplay() const { glutPostRedisplay(); }
+
 
+void opengl::t_render_state::render_scene(const epiks::t_state_snapshot& ss) {
+	EIGENPHYSIKS_PROFILE_ZONE("render::scene");
 
-void opengl::t_render_state::render_scene(const epiks::t_physics_state& ps) const {
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	{
+		EIGENPHYSIKS_PROFILE_ZONE("render::ground");
+
 		glBindBuffer(GL_ARRAY_BUFFER, m_quad_vbo_id);
 		glEnableClientState(GL_VERTEX_ARRAY);
 		glEnableClientState(GL_NORMAL_ARRAY);
@@ -185,115 +397,264 @@ void opengl::t_render_state::render_scene(const epiks::t_physics_state& ps) cons
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
 
-	for (size_t i = 0; i < epiks::t_physics_state::NUM_ARMS; i++) {
-		const epiks::t_rb_chain& arm = ps.get_arm(i);
-
-		t_pos3f goal_pos = arm.get_goal_pos();
-		t_pos3f base_pos = arm.get_base_pos();
+	const opengl::t_frustum frustum = m_opengl_camera.calc_frustum();
 
-		// same handedness as OpenGL
-		t_mat44f base_mat;
+	render_arms(ss, frustum);
+	render_rope(ss, frustum);
 
-		{
-			// goal-sphere
-			glPushMatrix();
-			glTranslatef(goal_pos.x(), goal_pos.y(), goal_pos.z());
-			gluQuadricDrawStyle(m_quadric_obj, GLU_FILL);
-			gluSphere(m_quadric_obj, 0.1f, 20, 20);
-			glPopMatrix();
+	if (m_debug_draw.is_enabled()) {
+		for (size_t i = 0; i < ss.get_num_chains(); i++) {
+			m_debug_draw.add_sphere(ss.chains[i].goal_pos, 0.1f, 0.8f, 0.8f, 0.8f);
 		}
+	}
 
+	m_debug_draw.flush(m_opengl_camera.calc_proj_mat(), m_opengl_camera.calc_view_mat());
+}
 
-		glPushMatrix();
-		glBindBuffer(GL_ARRAY_BUFFER, m_cone_vbo_id);
+void opengl::t_render_state::render_arms(const epiks::t_state_snapshot& ss, const opengl::t_frustum& frustum) {
+	EIGENPHYSIKS_PROFILE_ZONE_VAR(arms_timer, "render::arms");
 
-		glEnableClientState(GL_VERTEX_ARRAY);
-		glEnableClientState(GL_NORMAL_ARRAY);
+	if (m_num_arm_insts == 0)
+		return;
 
-		glVertexPointer(3, GL_FLOAT, cone_vbo_elem_size, cone_vbo_vertex_offset);
-		glNormalPointer(   GL_FLOAT, cone_vbo_elem_size, cone_vbo_normal_offset);
+	const t_pos3f& cam_pos = m_opengl_camera.get_pos();
 
+	uint32_t num_lod_insts[2] = {0, 0};
 
-		#if 0
-		// hack to use glMultiDrawArrays or glDrawArraysInstanced in FFP
-		static   float matrices[16 * 15 * 2 * 3] = {0.0f};
-		static   float  weights[16 * 15 * 2 * 3] = {0.0f};
-		static uint8_t  indices[     15 * 2 * 3] = {0   };
+	{
+		EIGENPHYSIKS_PROFILE_ZONE("render::arm_cull");
+
+		// fixed support-piece; rotated from +z onto +y, flattened
+		const t_mat44f support_mat = (t_mat44f() <<
+			0.5f, 0.0f,  0.0f, 0.0f,
+			0.0f, 0.0f,  0.1f, consts::WORLD_PARAMS.ground_plane_level,
+			0.0f, -0.5f, 0.0f, 0.0f,
+			0.0f, 0.0f,  0.0f, 1.0f
+		).finished();
+
+		m_cull_thread_pool.parallel_for(ss.get_num_chains(), cull_chunk_size, [&](size_t i) {
+			const epiks::t_chain_snapshot& arm = ss.chains[i];
+
+			t_pos3f base_pos = arm.base_pos;
+			t_pos3f min_pos = {base_pos.x(), consts::WORLD_PARAMS.ground_plane_level, base_pos.z()};
+			t_pos3f max_pos = min_pos;
+
+			// joint positions bound the chain, cone radii are padded below
+			for (size_t k = 0; k < arm.num_pieces; k++) {
+				const epiks::t_piece_snapshot& j = ss.pieces[arm.piece_offset + k];
+
+				min_pos = min_pos.cwiseMin(base_pos);
+				max_pos = max_pos.cwiseMax(base_pos);
+				base_pos = base_pos + j.rot * t_pos3f(0.0f, 0.0f, j.length);
+			}
 
-		glEnableClientState(GL_MATRIX_INDEX_ARRAY);
-		glEnableClientState(WEIGHT_ARRAY);
-		glMatrixIndexPointer(1, GL_UNSIGNED_BYTE, 0, &indices[0]); // per-vertex
-		glWeightPointer(1, GL_FLOAT, 0, &weights[0]);
-		glMatrixMode(GL_MATRIX_PALETTE);
+			min_pos = min_pos.cwiseMin(base_pos);
+			max_pos = max_pos.cwiseMax(base_pos);
 
-		for (size_t k = 0; k < arm.get_num_pieces(); k++) {
-			const epiks::t_rb_piece& j = arm.get_piece(k);
+			const t_pos3f center = (min_pos + max_pos) * 0.5f;
+			const float radius = (max_pos - min_pos).norm() * 0.5f + 0.15f;
 
-			base_mat = math::compose_transform_matrix(base_pos, j.get_transform());
-			base_pos = base_pos + j.get_tail_pos();
+			if (!frustum.test_sphere(center, radius)) {
+				m_chain_lods[i] = LOD_CULLED;
+				return;
+			}
 
-			glCurrentPaletteMatrix(k);
-			glLoadMatrixf(base_mat.data());
-		}
+			m_chain_lods[i] = ((cam_pos - center).norm() - radius > arm_lod_dist)? LOD_COARSE: LOD_FULL;
 
-		glMatrixMode(GL_MODELVIEW);
-		#endif
-
-
-		// fixed support-piece
-		glPushMatrix();
-		glTranslatef(base_pos.x(), consts::WORLD_PARAMS.ground_plane_level, base_pos.z());
-		glRotatef(-90.0f, 1.0f, 0.0f, 0.0f);
-		glScalef(0.5f, 0.5f, 0.1f);
-		glDrawArrays(GL_TRIANGLES, 0, num_cone_divs * num_cone_div_elems);
-		glPopMatrix();
-
-		for (const epiks::t_rb_piece& j: arm.get_pieces()) {
-			base_mat = math::compose_transform_matrix(base_pos, j.get_transform());
-			base_pos = base_pos + j.get_tail_pos();
-
-			glPushMatrix();
-			glMultMatrixf(base_mat.data());
-			glScalef(1.0f, 1.0f, j.get_length());
-			glDrawArrays(GL_TRIANGLES, 0, num_cone_divs * num_cone_div_elems);
-			glPopMatrix();
+			t_mat44f* inst_mats = &m_arm_inst_mats[m_chain_inst_offsets[i]];
+			t_mat44f scale_mat = t_mat44f::Identity();
+
+			base_pos = arm.base_pos;
+
+			*inst_mats = support_mat;
+			(*inst_mats)(0, 3) = base_pos.x();
+			(*inst_mats)(2, 3) = base_pos.z();
+			inst_mats++;
+
+			for (size_t k = 0; k < arm.num_pieces; k++) {
+				const epiks::t_piece_snapshot& j = ss.pieces[arm.piece_offset + k];
+
+				scale_mat(2, 2) = j.length;
+
+				// tail of this piece is the base of the next
+				*(inst_mats++) = math::compose_transform_matrix(base_pos, j.rot) * scale_mat;
+				base_pos = base_pos + j.rot * t_pos3f(0.0f, 0.0f, j.length);
+			}
+		});
+
+		// visible chains are packed per detail level, full ones first
+		for (size_t i = 0; i < ss.get_num_chains(); i++) {
+			if (m_chain_lods[i] == LOD_CULLED)
+				continue;
+
+			m_chain_draw_offsets[i] = num_lod_insts[m_chain_lods[i]];
+			num_lod_insts[m_chain_lods[i]] += (ss.chains[i].num_pieces + 1);
 		}
+	}
 
-		glDisableClientState(GL_NORMAL_ARRAY);
-		glDisableClientState(GL_VERTEX_ARRAY);
+	const uint32_t num_drawn_insts = num_lod_insts[LOD_FULL] + num_lod_insts[LOD_COARSE];
+
+	arms_timer.set_arg("insts", num_drawn_insts);
+
+	if (num_drawn_insts == 0)
+		return;
+
+	{
+		EIGENPHYSIKS_PROFILE_ZONE("render::arm_insts");
+
+		glBindBuffer(GL_ARRAY_BUFFER, m_arm_inst_vbo_id);
+
+		// invalidation lets the driver hand out fresh storage instead of
+		// waiting for the previous frame's draw to finish reading it
+		t_mat44f* inst_mats = reinterpret_cast<t_mat44f*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, num_drawn_insts * arm_inst_elem_size, arm_inst_flag_bits));
+
+		m_cull_thread_pool.parallel_for(ss.get_num_chains(), cull_chunk_size, [&](size_t i) {
+			if (m_chain_lods[i] == LOD_CULLED)
+				return;
+
+			const uint32_t dst_offset = m_chain_draw_offsets[i] + num_lod_insts[LOD_FULL] * (m_chain_lods[i] == LOD_COARSE);
+			const uint32_t src_offset = m_chain_inst_offsets[i];
+
+			std::copy(&m_arm_inst_mats[src_offset], &m_arm_inst_mats[src_offset] + ss.chains[i].num_pieces + 1, inst_mats + dst_offset);
+		});
 
+		glUnmapBuffer(GL_ARRAY_BUFFER);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glPopMatrix();
 	}
 
 	{
-		glBindBuffer(GL_ARRAY_BUFFER, m_rope_vbo_id);
-		glEnableClientState(GL_VERTEX_ARRAY);
-		glVertexPointer(3, GL_FLOAT, rope_vbo_elem_size, rope_vbo_vertex_offset);
+		float light_pos[2][4];
+		float light_ambi[2][4];
+		float light_diff[2][4];
+
+		for (uint32_t i = 0; i < 2; i++) {
+			std::copy(m_opengl_lights[i].get_position(), m_opengl_lights[i].get_position() + 4, light_pos[i]);
+			std::copy(m_opengl_lights[i].get_ambi_clr(), m_opengl_lights[i].get_ambi_clr() + 4, light_ambi[i]);
+			std::copy(m_opengl_lights[i].get_diff_clr(), m_opengl_lights[i].get_diff_clr() + 4, light_diff[i]);
+		}
 
-		const epiks::t_spring_grid& rope = ps.get_rope();
+		m_arm_shader.enable();
 
-		for (size_t idx = 0; idx < rope.get_num_springs(); ++idx) {
-			const epiks::t_point_object& lhs_obj = rope.get_object(idx    );
-			const epiks::t_point_object& rhs_obj = rope.get_object(idx + 1);
+		glUniformMatrix4fv(m_arm_proj_mat_loc, 1, GL_FALSE, m_opengl_camera.calc_proj_mat().data());
+		glUniformMatrix4fv(m_arm_view_mat_loc, 1, GL_FALSE, m_opengl_camera.calc_view_mat().data());
+		glUniform4fv(m_arm_light_pos_loc, 2, &light_pos[0][0]);
+		glUniform4fv(m_arm_light_ambi_loc, 2, &light_ambi[0][0]);
+		glUniform4fv(m_arm_light_diff_loc, 2, &light_diff[0][0]);
 
-			const t_vec3f& lhs_pos = lhs_obj.get_pos();
-			const t_vec3f& rhs_pos = rhs_obj.get_pos();
+		glBindVertexArray(m_arm_vao_id);
 
-			m_rope_vbo_ptr[idx * 6 + 0] = lhs_pos.x();
-			m_rope_vbo_ptr[idx * 6 + 1] = lhs_pos.y();
-			m_rope_vbo_ptr[idx * 6 + 2] = lhs_pos.z();
+		if (num_lod_insts[LOD_FULL] != 0)
+			glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, num_cone_elems, num_lod_insts[LOD_FULL], 0);
+		if (num_lod_insts[LOD_COARSE] != 0)
+			glDrawArraysInstancedBaseInstance(GL_TRIANGLES, num_cone_elems, num_lod_cone_elems, num_lod_insts[LOD_COARSE], num_lod_insts[LOD_FULL]);
 
-			m_rope_vbo_ptr[idx * 6 + 3] = rhs_pos.x();
-			m_rope_vbo_ptr[idx * 6 + 4] = rhs_pos.y();
-			m_rope_vbo_ptr[idx * 6 + 5] = rhs_pos.z();
-		}
+		glBindVertexArray(0);
 
-		glLineWidth(4.0f);
-		glDrawArrays(GL_LINES, 0, rope.get_num_springs() * 2);
-		glDisableClientState(GL_VERTEX_ARRAY);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glLineWidth(1.0f);
+		m_arm_shader.disable();
 	}
 }
 
+void opengl::t_render_state::render_rope(const epiks::t_state_snapshot& ss, const opengl::t_frustum& frustum) {
+	EIGENPHYSIKS_PROFILE_ZONE_VAR(rope_timer, "render::rope");
+
+	if (m_num_rope_indices == 0)
+		return;
+
+	assert(ss.get_num_objects() == m_num_rope_verts);
+
+	{
+		EIGENPHYSIKS_PROFILE_ZONE("render::rope_cull");
+
+		const t_pos3f& cam_pos = m_opengl_camera.get_pos();
+
+		// bounds cover both ends of every (full) spring in the tile
+		m_cull_thread_pool.parallel_for(m_rope_tiles.size(), cull_chunk_size, [&](size_t i) {
+			const t_rope_tile& tile = m_rope_tiles[i];
+
+			if (tile.index_counts[LOD_FULL] == 0) {
+				m_rope_tile_lods[i] = LOD_CULLED;
+				return;
+			}
+
+			t_pos3f min_pos = ss.obj_positions[m_rope_indices[tile.index_offsets[LOD_FULL]]];
+			t_pos3f max_pos = min_pos;
+
+			for (uint32_t k = 0; k < tile.index_counts[LOD_FULL]; k++) {
+				const t_pos3f& pos = ss.obj_positions[m_rope_indices[tile.index_offsets[LOD_FULL] + k]];
+
+				min_pos = min_pos.cwiseMin(pos);
+				max_pos = max_pos.cwiseMax(pos);
+			}
+
+			const t_pos3f center = (min_pos + max_pos) * 0.5f;
+			const float radius = (max_pos - min_pos).norm() * 0.5f;
+
+			if (!frustum.test_sphere(center, radius)) {
+				m_rope_tile_lods[i] = LOD_CULLED;
+				return;
+			}
+
+			// tiles without coarse springs (e.g. single-object tails) stay full
+			const bool coarse = ((cam_pos - center).norm() - radius > rope_lod_dist) && (tile.index_counts[LOD_COARSE] != 0);
+
+			m_rope_tile_lods[i] = coarse? LOD_COARSE: LOD_FULL;
+		});
+	}
+
+	GLsync& fence = m_rope_vbo_fences[m_rope_vbo_region];
+
+	if (fence != nullptr) {
+		EIGENPHYSIKS_PROFILE_ZONE("render::rope_wait");
+
+		// only blocks if the GPU is num_rope_vbo_regions frames behind
+		while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED);
+
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	float* region_ptr = m_rope_vbo_ptr + m_rope_vbo_region * m_num_rope_verts * 3;
+
+	for (size_t idx = 0; idx < m_num_rope_verts; idx++) {
+		const t_pos3f& pos = ss.obj_positions[idx];
+
+		region_ptr[idx * 3 + 0] = pos.x();
+		region_ptr[idx * 3 + 1] = pos.y();
+		region_ptr[idx * 3 + 2] = pos.z();
+	}
+
+	m_rope_draw_counts.clear();
+	m_rope_draw_offsets.clear();
+
+	// one range per visible tile, full-detail ranges first
+	for (uint32_t lod = LOD_FULL; lod <= LOD_COARSE; lod++) {
+		for (size_t i = 0; i < m_rope_tiles.size(); i++) {
+			if (m_rope_tile_lods[i] != lod)
+				continue;
+
+			m_rope_draw_counts.push_back(m_rope_tiles[i].index_counts[lod]);
+			m_rope_draw_offsets.push_back(reinterpret_cast<const void*>(m_rope_tiles[i].index_offsets[lod] * sizeof(uint32_t)));
+		}
+	}
+
+	m_rope_draw_base_verts.assign(m_rope_draw_counts.size(), m_rope_vbo_region * m_num_rope_verts);
+
+	rope_timer.set_arg("ranges", m_rope_draw_counts.size());
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_rope_vbo_id);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_rope_ibo_id);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(3, GL_FLOAT, rope_vbo_elem_size, rope_vbo_vertex_offset);
+
+	glLineWidth(4.0f);
+	glMultiDrawElementsBaseVertex(GL_LINES, m_rope_draw_counts.data(), GL_UNSIGNED_INT, m_rope_draw_offsets.data(), m_rope_draw_counts.size(), m_rope_draw_base_verts.data());
+	glLineWidth(1.0f);
+
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	m_rope_vbo_region = (m_rope_vbo_region + 1) % num_rope_vbo_regions;
+}
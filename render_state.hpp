@@ -1,49 +1,67 @@
 #ifndef EIGENPHYSIKS_RENDER_STATE_HDR
 #define EIGENPHYSIKS_RENDER_STATE_HDR
 
+#include <vector>
+
 #include "eigen_types.hpp"
 #include "opengl_camera.hpp"
+#include "opengl_debug_draw.hpp"
 #include "opengl_light.hpp"
-
-struct GLUquadric;
+#include "opengl_shader.hpp"
+#include "thread_pool.hpp"
 
 namespace epiks {
-	struct t_physics_state;
+	struct t_state_snapshot;
 };
 
 namespace opengl {
 	struct t_render_state {
 	public:
-		void init(const epiks::t_physics_state& ps);
+		void init(const epiks::t_state_snapshot& ss);
 		void kill();
 
 		void setup_camera();
-		void setup_lights(const epiks::t_physics_state& ps);
+		void setup_lights(const epiks::t_state_snapshot& ss);
 		void swap_buffers() const;
-		void render_scene(const epiks::t_physics_state& ps) const;
+		void post_redisplay() const;
+		void render_scene(const epiks::t_state_snapshot& ss);
+		void render_arms(const epiks::t_state_snapshot& ss, const opengl::t_frustum& frustum);
+		void render_rope(const epiks::t_state_snapshot& ss, const opengl::t_frustum& frustum);
 
 		opengl::t_camera& get_camera() { return m_opengl_camera; }
 		opengl::t_light& get_light(size_t i) { return m_opengl_lights[i]; }
+		opengl::t_debug_draw& get_debug_draw() { return m_debug_draw; }
 
 	public:
 		uint32_t m_cone_vbo_id;
 		uint32_t m_quad_vbo_id;
 		uint32_t m_rope_vbo_id;
+		uint32_t m_rope_ibo_id;
+
+		// one instance (transform) per arm piece plus one per support piece,
+		// all drawn from the cone VBO with one instanced call per detail level
+		uint32_t m_arm_vao_id;
+		uint32_t m_arm_inst_vbo_id;
+		uint32_t m_num_arm_insts;
 
 		static constexpr uint32_t cone_vbo_elem_size = sizeof(t_pos3f) + sizeof(t_vec3f); // v+n
 		static constexpr uint32_t cone_vbo_flag_bits = GL_MAP_WRITE_BIT;
 		static constexpr uint32_t quad_vbo_elem_size = sizeof(t_pos3f) + sizeof(t_vec3f); // v+n
 		static constexpr uint32_t quad_vbo_flag_bits = GL_MAP_WRITE_BIT;
 		static constexpr uint32_t rope_vbo_elem_size = sizeof(t_pos3f); // v
-		static constexpr uint32_t rope_vbo_flag_bits = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT;
+		static constexpr uint32_t rope_vbo_flag_bits = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		static constexpr uint32_t arm_inst_elem_size = sizeof(t_mat44f); // model matrix, scale included
+		static constexpr uint32_t arm_inst_flag_bits = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;
 
 		static constexpr uint32_t num_cone_divs          = 15;
+		static constexpr uint32_t num_lod_cone_divs      = 6; // coarse cone, stored after the full one
 		static constexpr uint32_t num_cone_div_elems     = 2 * 3; // elements per div
 		static constexpr uint32_t num_cone_elems         = num_cone_divs * num_cone_div_elems;
+		static constexpr uint32_t num_lod_cone_elems     = num_lod_cone_divs * num_cone_div_elems;
 		static constexpr uint32_t num_quad_elems         = 4;
 		static constexpr uint32_t num_cone_elem_floats   = cone_vbo_elem_size / sizeof(float); // floats per element
 		static constexpr uint32_t num_cone_div_floats    = num_cone_div_elems * num_cone_elem_floats; // floats per div
-		static constexpr uint32_t num_cone_vbo_bytes     = num_cone_elems * cone_vbo_elem_size;
+		static constexpr uint32_t num_cone_vbo_bytes     = (num_cone_elems + num_lod_cone_elems) * cone_vbo_elem_size;
 		static constexpr uint32_t num_quad_vbo_bytes     = num_quad_elems * quad_vbo_elem_size;
 
 		static constexpr void* cone_vbo_vertex_offset = reinterpret_cast<void*>(              0);
@@ -56,11 +74,67 @@ namespace opengl {
 		float* m_quad_vbo_ptr;
 		float* m_rope_vbo_ptr;
 
-		GLUquadric* m_quadric_obj;
+		// the rope VBO holds this many copies (regions) of every object position,
+		// written round-robin; each region is fenced after the draw reading it
+		// so the CPU never overwrites vertices the GPU has yet to consume
+		static constexpr uint32_t num_rope_vbo_regions = 3;
+
+		uint32_t m_num_rope_verts;
+		uint32_t m_num_rope_indices;
+		uint32_t m_rope_vbo_region;
+
+		GLsync m_rope_vbo_fences[num_rope_vbo_regions];
+
+		// visibility; chains and rope tiles (ranges of objects with their
+		// springs) are culled against the camera frustum by bounds computed
+		// each frame, and drawn with less detail beyond a distance
+		enum {
+			LOD_FULL   = 0,
+			LOD_COARSE = 1,
+			LOD_CULLED = 2,
+		};
+
+		struct t_rope_tile {
+			// {full, coarse} index ranges; coarse springs join even objects
+			uint32_t index_offsets[2];
+			uint32_t index_counts[2];
+		};
+
+		static constexpr float arm_lod_dist = 25.0f;
+		static constexpr float rope_lod_dist = 25.0f;
+
+		static constexpr uint32_t rope_tile_size = 64; // objects per tile, even
+		static constexpr size_t cull_chunk_size = 32;
+
+		std::vector<uint32_t> m_rope_indices; // full springs, ordered by tile
+		std::vector<t_rope_tile> m_rope_tiles;
+		std::vector<uint8_t> m_rope_tile_lods;
+
+		std::vector<int32_t> m_rope_draw_counts;
+		std::vector<const void*> m_rope_draw_offsets;
+		std::vector<int32_t> m_rope_draw_base_verts;
+
+		std::vector<uint32_t> m_chain_inst_offsets; // static, into m_arm_inst_mats
+		std::vector<uint32_t> m_chain_draw_offsets; // per frame, into the instance VBO
+		std::vector<uint8_t> m_chain_lods;
+		std::vector<t_mat44f> m_arm_inst_mats;
+
+		util::t_thread_pool m_cull_thread_pool = {std::max(std::thread::hardware_concurrency() / 2, 1u)};
+
+		opengl::t_shader_program m_arm_shader;
+
+		int32_t m_arm_proj_mat_loc;
+		int32_t m_arm_view_mat_loc;
+		int32_t m_arm_light_pos_loc;
+		int32_t m_arm_light_ambi_loc;
+		int32_t m_arm_light_diff_loc;
 
 	public:
 		opengl::t_camera m_opengl_camera;
 		opengl::t_light m_opengl_lights[2];
+
+		// goal markers and other non-scene shapes
+		opengl::t_debug_draw m_debug_draw;
 	};
 };
 
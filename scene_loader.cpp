@@ -0,0 +1,200 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "checkpoint.hpp"
+#include "physics_state.hpp"
+#include "profiler.hpp"
+#include "scene_loader.hpp"
+
+static constexpr size_t MAX_LINE_LENGTH = 1024;
+static constexpr size_t MAX_LINE_VALUES = 8;
+
+// splits the values following a keyword; false if there are not exactly n
+// only the value at index_pos may be symbolic (an object index, e.g. tail)
+static bool parse_values(char* str, float* values, size_t n, size_t index_pos = size_t(-1)) {
+	size_t i = 0;
+
+	for (char* tok = std::strtok(str, " \t\r\n"); tok != nullptr; tok = std::strtok(nullptr, " \t\r\n")) {
+		char* end = nullptr;
+
+		if (i == n)
+			return false;
+
+		// a symbolic index is passed through as -1
+		values[i] = (i == index_pos && std::strcmp(tok, "tail") == 0)? -1.0f: std::strtof(tok, &end);
+		i += 1;
+
+		if (end != nullptr && *end != '\0')
+			return false;
+	}
+
+	return (i == n);
+}
+
+
+bool epiks::load_scene_text(t_physics_state& ps, const char* file_name) {
+	EIGENPHYSIKS_PROFILE_ZONE("scene::load_text");
+
+	FILE* file = std::fopen(file_name, "r");
+
+	if (file == nullptr) {
+		std::fprintf(stderr, "[scene::%s] can not open \"%s\"\n", __func__, file_name);
+		return false;
+	}
+
+	t_world_params world_params = consts::WORLD_PARAMS;
+	t_spring_base_params spring_params = consts::SPRING_PARAMS;
+
+	std::vector<t_spring_grid> grids;
+	std::vector<t_rb_chain> chains;
+	std::vector<t_chain_attachment> attachments;
+
+	char line[MAX_LINE_LENGTH];
+	char keyword[MAX_LINE_LENGTH];
+	float v[MAX_LINE_VALUES];
+
+	size_t line_num = 0;
+
+	const auto fail = [&](const char* what) {
+		std::fprintf(stderr, "[scene::load_scene_text] %s:%lu: %s\n", file_name, (unsigned long) line_num, what);
+		std::fclose(file);
+		return false;
+	};
+
+	while (std::fgets(line, sizeof(line), file) != nullptr) {
+		line_num += 1;
+
+		if (char* comment = std::strchr(line, '#'))
+			*comment = '\0';
+
+		int keyword_len = 0;
+
+		if (std::sscanf(line, "%s%n", keyword, &keyword_len) != 1)
+			continue;
+
+		char* values = line + keyword_len;
+
+		if (std::strcmp(keyword, "world") == 0) {
+			if (!parse_values(values, v, 6))
+				return (fail("world takes 6 values"));
+
+			world_params = {v[0], v[1], v[2], v[3], v[4], v[5]};
+			continue;
+		}
+
+		if (std::strcmp(keyword, "springs") == 0) {
+			if (!parse_values(values, v, 4))
+				return (fail("springs takes 4 values"));
+
+			spring_params = {v[0], v[1], v[2], v[3]};
+			continue;
+		}
+
+		if (std::strcmp(keyword, "grid") == 0) {
+			if (!parse_values(values, v, 6) || v[0] < 1.0f || v[1] < 1.0f || v[2] <= 0.0f)
+				return (fail("grid takes 6 values, sizes >= 1 and mass > 0"));
+
+			grids.emplace_back(t_spring_grid_params{size_t(v[0]), size_t(v[1]), v[2], 0.0f, {v[3], v[4], v[5]}}, spring_params, world_params);
+			continue;
+		}
+
+		if (std::strcmp(keyword, "anchor") == 0) {
+			if (grids.empty())
+				return (fail("anchor before any grid"));
+			if (!parse_values(values, v, 4) || v[0] < 0.0f || size_t(v[0]) >= grids.back().get_num_objects())
+				return (fail("anchor takes 4 values and an in-range object index"));
+
+			grids.back().add_anchor({size_t(v[0]), {v[1], v[2], v[3]}, {0.0f, 0.0f, 0.0f}});
+			continue;
+		}
+
+		if (std::strcmp(keyword, "chain") == 0) {
+			if (!parse_values(values, v, 3))
+				return (fail("chain takes 3 values"));
+
+			chains.emplace_back();
+			chains.back().set_base_pos({v[0], v[1], v[2]});
+			chains.back().set_goal_pos({0.0f, world_params.ground_plane_level + 10.0f, 0.0f}); // forces an initial solve
+			continue;
+		}
+
+		if (std::strcmp(keyword, "piece") == 0) {
+			if (chains.empty())
+				return (fail("piece before any chain"));
+			if (!parse_values(values, v, 1) || v[0] <= 0.0f)
+				return (fail("piece takes a positive length"));
+
+			chains.back().add_piece(v[0]);
+			continue;
+		}
+
+		if (std::strcmp(keyword, "attach") == 0) {
+			if (chains.empty())
+				return (fail("attach before any chain"));
+			if (!parse_values(values, v, 3, 1) || v[0] < 0.0f || size_t(v[0]) >= grids.size())
+				return (fail("attach takes 3 values and an in-range grid index"));
+
+			const t_spring_grid& grid = grids[size_t(v[0])];
+			const size_t obj_idx = (v[1] < 0.0f)? grid.get_tail_obj_idx(): size_t(v[1]);
+
+			if (obj_idx >= grid.get_num_objects())
+				return (fail("attach object index out of range"));
+
+			attachments.push_back({chains.size() - 1, size_t(v[0]), obj_idx, v[2]});
+			continue;
+		}
+
+		return (fail("unknown keyword"));
+	}
+
+	if (const char* what = check_scene(grids, chains))
+		return (fail(what));
+
+	std::fclose(file);
+
+	for (const t_spring_grid& grid: grids) {
+		ps.add_grid(grid);
+	}
+	for (const t_rb_chain& chain: chains) {
+		ps.add_chain(chain);
+	}
+	for (const t_chain_attachment& a: attachments) {
+		ps.add_attachment(a);
+	}
+
+	ps.init_scene();
+	return true;
+}
+
+
+bool epiks::compile_scene(const char* text_file_name, const char* binary_file_name) {
+	t_physics_state ps;
+
+	if (!load_scene_text(ps, text_file_name))
+		return false;
+
+	return (save_checkpoint(ps, binary_file_name));
+}
+
+bool epiks::load_scene(t_physics_state& ps, const char* file_name) {
+	FILE* file = std::fopen(file_name, "rb");
+
+	if (file == nullptr) {
+		std::fprintf(stderr, "[scene::%s] can not open \"%s\"\n", __func__, file_name);
+		return false;
+	}
+
+	uint64_t magic = 0;
+
+	// binary scenes are checkpoints
+	const bool is_binary = (std::fread(&magic, sizeof(magic), 1, file) == 1 && magic == ckpt::FILE_MAGIC);
+
+	std::fclose(file);
+
+	if (is_binary)
+		return (load_checkpoint(ps, file_name));
+
+	return (load_scene_text(ps, file_name));
+}
@@ -0,0 +1,31 @@
+#ifndef EIGENPHYSIKS_SCENE_LOADER_HDR
+#define EIGENPHYSIKS_SCENE_LOADER_HDR
+
+namespace epiks {
+	struct t_physics_state;
+
+	// line-based text scene; '#' starts a comment, every other line is a
+	// keyword followed by whitespace-separated values:
+	//
+	//   world   <atmos_frict> <ground_repul> <ground_frict> <ground_absor> <ground_level> <ground_scale>
+	//   springs <rest_length> <thickness> <stiffness> <damping>
+	//   grid    <num_links_x> <num_links_y> <link_mass> <gravity_x> <gravity_y> <gravity_z>
+	//   anchor  <obj_idx> <pos_x> <pos_y> <pos_z>
+	//   chain   <base_x> <base_y> <base_z>
+	//   piece   <length>
+	//   attach  <grid_idx> <obj_idx|tail> <pull_coeff>
+	//
+	// world and springs apply to every grid that follows them, anchors to
+	// the last grid, pieces and attachments to the last chain; grid and
+	// object indices are in declaration order and grid-space respectively
+	bool load_scene_text(t_physics_state& ps, const char* file_name);
+
+	// the binary form is a checkpoint (see checkpoint.hpp) of the freshly
+	// loaded scene, so loading it involves no per-object construction
+	bool compile_scene(const char* text_file_name, const char* binary_file_name);
+
+	// loads either form, told apart by the checkpoint magic
+	bool load_scene(t_physics_state& ps, const char* file_name);
+};
+
+#endif
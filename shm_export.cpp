@@ -0,0 +1,305 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "shm_export.hpp"
+#include "profiler.hpp"
+
+static_assert(sizeof(t_pos3f) == (sizeof(float) * 3), "t_pos3f must be a packed xyz triple");
+
+static constexpr uint32_t NUM_READ_ATTEMPTS = 4;
+
+static uint64_t align_section(uint64_t n) { return ((n + epiks::shmx::SECTION_ALIGNMENT - 1) & ~(epiks::shmx::SECTION_ALIGNMENT - 1)); }
+
+static uint64_t calc_topology_size(uint64_t num_springs, uint64_t num_grids, uint64_t num_chains) { return ((num_springs * 2 + num_grids + num_chains * 2) * sizeof(uint32_t)); }
+static uint64_t calc_payload_size(uint64_t num_objects, uint64_t num_chains, uint64_t num_pieces) { return ((num_objects * 3 + num_chains * 6 + num_pieces * 5) * sizeof(float)); }
+
+static std::string make_shm_name(const char* shm_name) { return ((shm_name[0] == '/')? std::string(shm_name): ("/" + std::string(shm_name))); }
+
+
+
+bool epiks::t_shm_exporter::start(const char* shm_name, const t_state_snapshot& ss, uint32_t num_slots) {
+	if (is_running() || num_slots == 0)
+		return false;
+
+	m_shm_name = make_shm_name(shm_name);
+
+	const uint64_t topology_offset = align_section(sizeof(shmx::t_shm_header));
+	const uint64_t slots_offset = topology_offset + align_section(calc_topology_size(ss.get_num_springs(), ss.grid_tail_indices.size(), ss.get_num_chains()));
+	const uint64_t slot_size = align_section(sizeof(shmx::t_slot_header) + calc_payload_size(ss.get_num_objects(), ss.get_num_chains(), ss.pieces.size()));
+	const uint64_t shm_size = slots_offset + slot_size * num_slots;
+
+	// readers of a previous run keep their (now orphaned) object
+	shm_unlink(m_shm_name.c_str());
+
+	const int fd = shm_open(m_shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+
+	if (fd < 0) {
+		std::fprintf(stderr, "[shm::%s] can not create \"%s\"\n", __func__, m_shm_name.c_str());
+		return false;
+	}
+
+	void* shm_addr = MAP_FAILED;
+
+	if (ftruncate(fd, shm_size) == 0)
+		shm_addr = mmap(nullptr, shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+	::close(fd);
+
+	if (shm_addr == MAP_FAILED) {
+		std::fprintf(stderr, "[shm::%s] can not map %lu bytes of \"%s\"\n", __func__, (unsigned long) shm_size, m_shm_name.c_str());
+		shm_unlink(m_shm_name.c_str());
+		return false;
+	}
+
+	m_shm_addr = static_cast<uint8_t*>(shm_addr);
+	m_header = new (m_shm_addr) shmx::t_shm_header();
+	m_num_frames = 0;
+	m_num_skipped = 0;
+
+	m_header->version = shmx::SHM_VERSION;
+	m_header->num_slots = num_slots;
+	m_header->shm_size = shm_size;
+	m_header->slot_size = slot_size;
+	m_header->topology_offset = topology_offset;
+	m_header->slots_offset = slots_offset;
+	m_header->num_objects = ss.get_num_objects();
+	m_header->num_springs = ss.get_num_springs();
+	m_header->num_grids = ss.grid_tail_indices.size();
+	m_header->num_chains = ss.get_num_chains();
+	m_header->num_pieces = ss.pieces.size();
+
+	uint32_t* topology = reinterpret_cast<uint32_t*>(m_shm_addr + topology_offset);
+
+	topology = std::copy(ss.spring_indices.begin(), ss.spring_indices.end(), topology);
+	topology = std::copy(ss.grid_tail_indices.begin(), ss.grid_tail_indices.end(), topology);
+
+	for (const t_chain_snapshot& c: ss.chains) {
+		*(topology++) = c.piece_offset;
+		*(topology++) = c.num_pieces;
+	}
+
+	for (uint32_t i = 0; i < num_slots; i++) {
+		new (m_shm_addr + slots_offset + slot_size * i) shmx::t_slot_header();
+	}
+
+	// readers validate the magic first; everything before it must be visible
+	std::atomic_thread_fence(std::memory_order_release);
+	m_header->magic = shmx::SHM_MAGIC;
+
+	std::fprintf(stdout, "[shm::%s] exporting to \"%s\" (%lu bytes, %u slots)\n", __func__, m_shm_name.c_str(), (unsigned long) shm_size, num_slots);
+
+	export_frame(ss);
+	return true;
+}
+
+void epiks::t_shm_exporter::stop() {
+	if (!is_running())
+		return;
+
+	std::fprintf(stdout, "[shm::%s] exported %lu frames (%lu skipped)\n", __func__, (unsigned long) m_num_frames, (unsigned long) m_num_skipped);
+
+	munmap(m_shm_addr, m_header->shm_size);
+	shm_unlink(m_shm_name.c_str());
+
+	m_shm_addr = nullptr;
+	m_header = nullptr;
+}
+
+
+void epiks::t_shm_exporter::export_frame(const t_state_snapshot& ss) {
+	EIGENPHYSIKS_PROFILE_ZONE("shm::export");
+
+	// the layout was sized for the first frame's topology
+	if (ss.get_num_objects() != m_header->num_objects || ss.get_num_chains() != m_header->num_chains || ss.pieces.size() != m_header->num_pieces) {
+		m_num_skipped += 1;
+		return;
+	}
+
+	const uint64_t n = m_num_frames++;
+
+	uint8_t* slot = m_shm_addr + m_header->slots_offset + m_header->slot_size * (n % m_header->num_slots);
+	shmx::t_slot_header* slot_header = reinterpret_cast<shmx::t_slot_header*>(slot);
+	float* values = reinterpret_cast<float*>(slot + sizeof(shmx::t_slot_header));
+
+	// odd while writing; the fence keeps payload stores from moving above it
+	slot_header->sequence.store(n * 2 + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	slot_header->tick_index = ss.tick_index;
+	slot_header->publish_time_ns = ss.publish_time_ns;
+
+	std::memcpy(values, ss.obj_positions.data()->data(), ss.get_num_objects() * sizeof(t_pos3f));
+	values += (ss.get_num_objects() * 3);
+
+	for (const t_chain_snapshot& c: ss.chains) {
+		values = std::copy(c.base_pos.data(), c.base_pos.data() + 3, values);
+		values = std::copy(c.goal_pos.data(), c.goal_pos.data() + 3, values);
+	}
+	for (const t_piece_snapshot& p: ss.pieces) {
+		const t_quat4f q = t_quat4f(p.rot);
+
+		values = std::copy(q.coeffs().data(), q.coeffs().data() + 4, values);
+		*(values++) = p.length;
+	}
+
+	slot_header->sequence.store(n * 2 + 2, std::memory_order_release);
+	m_header->num_frames.store(n + 1, std::memory_order_release);
+}
+
+
+
+bool epiks::t_shm_reader::open(const char* shm_name) {
+	if (is_open())
+		return false;
+
+	const std::string name = make_shm_name(shm_name);
+	const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+
+	if (fd < 0) {
+		std::fprintf(stderr, "[shm::%s] can not open \"%s\"\n", __func__, name.c_str());
+		return false;
+	}
+
+	struct stat st;
+
+	if (fstat(fd, &st) != 0 || uint64_t(st.st_size) < sizeof(shmx::t_shm_header)) {
+		std::fprintf(stderr, "[shm::%s] \"%s\" is too small\n", __func__, name.c_str());
+		::close(fd);
+		return false;
+	}
+
+	void* shm_addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+	::close(fd);
+
+	if (shm_addr == MAP_FAILED) {
+		std::fprintf(stderr, "[shm::%s] can not map \"%s\"\n", __func__, name.c_str());
+		return false;
+	}
+
+	m_shm_addr = static_cast<const uint8_t*>(shm_addr);
+	m_shm_size = st.st_size;
+	m_header = reinterpret_cast<const shmx::t_shm_header*>(m_shm_addr);
+
+	const bool valid_magic = (m_header->magic == shmx::SHM_MAGIC);
+
+	std::atomic_thread_fence(std::memory_order_acquire);
+
+	const auto is_valid = [&]() {
+		const shmx::t_shm_header& h = *m_header;
+
+		if (!valid_magic || h.version != shmx::SHM_VERSION || h.shm_size != m_shm_size || h.num_slots == 0)
+			return false;
+		if (h.topology_offset + calc_topology_size(h.num_springs, h.num_grids, h.num_chains) > h.slots_offset)
+			return false;
+		if (sizeof(shmx::t_slot_header) + calc_payload_size(h.num_objects, h.num_chains, h.num_pieces) > h.slot_size)
+			return false;
+
+		return (h.slots_offset + h.slot_size * h.num_slots <= m_shm_size);
+	};
+
+	if (!is_valid()) {
+		std::fprintf(stderr, "[shm::%s] \"%s\" is not a version-%u ring\n", __func__, name.c_str(), shmx::SHM_VERSION);
+		close();
+		return false;
+	}
+
+	// only the newest frame at attach time is still worth reading
+	m_num_frames = m_header->num_frames.load(std::memory_order_acquire);
+	m_num_frames -= (m_num_frames > 0);
+	m_num_missed = 0;
+	return true;
+}
+
+void epiks::t_shm_reader::close() {
+	if (!is_open())
+		return;
+
+	std::fprintf(stdout, "[shm::%s] missed %lu frames\n", __func__, (unsigned long) m_num_missed);
+
+	munmap(const_cast<uint8_t*>(m_shm_addr), m_shm_size);
+
+	m_shm_addr = nullptr;
+	m_header = nullptr;
+}
+
+
+bool epiks::t_shm_reader::read_frame(t_state_snapshot& ss) {
+	EIGENPHYSIKS_PROFILE_ZONE("shm::read");
+
+	const shmx::t_shm_header& h = *m_header;
+
+	// topology is static, only copy it into snapshots that have not seen it yet
+	if (ss.spring_indices.size() != (h.num_springs * 2) || ss.grid_tail_indices.size() != h.num_grids || ss.chains.size() != h.num_chains) {
+		const uint32_t* topology = reinterpret_cast<const uint32_t*>(m_shm_addr + h.topology_offset);
+
+		ss.spring_indices.assign(topology, topology + h.num_springs * 2);
+		ss.grid_tail_indices.assign(topology + h.num_springs * 2, topology + h.num_springs * 2 + h.num_grids);
+		ss.chains.resize(h.num_chains);
+
+		topology += (h.num_springs * 2 + h.num_grids);
+
+		for (t_chain_snapshot& c: ss.chains) {
+			c.piece_offset = *(topology++);
+			c.num_pieces = *(topology++);
+		}
+	}
+
+	ss.obj_positions.resize(h.num_objects);
+	ss.pieces.resize(h.num_pieces);
+
+	for (uint32_t attempt = 0; attempt < NUM_READ_ATTEMPTS; attempt++) {
+		const uint64_t num_frames = h.num_frames.load(std::memory_order_acquire);
+
+		if (num_frames <= m_num_frames)
+			return false;
+
+		const uint64_t n = num_frames - 1;
+
+		const uint8_t* slot = m_shm_addr + h.slots_offset + h.slot_size * (n % h.num_slots);
+		const shmx::t_slot_header* slot_header = reinterpret_cast<const shmx::t_slot_header*>(slot);
+		const float* values = reinterpret_cast<const float*>(slot + sizeof(shmx::t_slot_header));
+
+		const uint64_t sequence = slot_header->sequence.load(std::memory_order_acquire);
+
+		// already being overwritten by a newer frame, start over from that one
+		if (sequence != (n * 2 + 2))
+			continue;
+
+		ss.tick_index = slot_header->tick_index;
+		ss.publish_time_ns = slot_header->publish_time_ns;
+
+		std::memcpy(ss.obj_positions.data()->data(), values, h.num_objects * sizeof(t_pos3f));
+		values += (h.num_objects * 3);
+
+		for (t_chain_snapshot& c: ss.chains) {
+			c.base_pos = {values[0], values[1], values[2]};
+			c.goal_pos = {values[3], values[4], values[5]};
+			values += 6;
+		}
+		for (t_piece_snapshot& p: ss.pieces) {
+			p.rot = t_rot4f(t_quat4f(values[3], values[0], values[1], values[2]));
+			p.length = values[4];
+			values += 5;
+		}
+
+		// the payload reads above must complete before the counter is re-checked
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		if (slot_header->sequence.load(std::memory_order_relaxed) != sequence)
+			continue;
+
+		m_num_missed += (n - m_num_frames);
+		m_num_frames = num_frames;
+		return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,119 @@
+#ifndef EIGENPHYSIKS_SHM_EXPORT_HDR
+#define EIGENPHYSIKS_SHM_EXPORT_HDR
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "state_snapshot.hpp"
+
+namespace epiks {
+	// POSIX shared-memory layout (native endianness, every section 64-byte
+	// aligned) of a ring of per-tick frames that local processes can map and
+	// read in place; the static topology follows the header, then num_slots
+	// fixed-size slots, frame N living in slot N % num_slots
+	//
+	// every slot is guarded by a sequence counter (seqlock): it is odd while
+	// the writer fills the slot and 2*(N+1) once frame N is complete; readers
+	// copy what they need and re-check the counter, so the writer never waits
+	// for (or even knows about) them and a slow reader only loses frames
+	namespace shmx {
+		static constexpr uint64_t SHM_MAGIC = 0x4d48534b53495045ull; // "EPIKSSHM"
+		static constexpr uint32_t SHM_VERSION = 1;
+
+		static constexpr uint32_t DEFAULT_NUM_SLOTS = 8;
+		static constexpr uint64_t SECTION_ALIGNMENT = 64;
+
+		static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared counters must be lock-free");
+
+		struct t_shm_header {
+			uint64_t magic;
+			uint32_t version;
+			uint32_t num_slots;
+
+			uint64_t shm_size;
+			uint64_t slot_size; // t_slot_header plus payload, padded
+
+			// topology; uint32[2] per spring, uint32 per grid tail and
+			// uint32[2] {piece_offset,num_pieces} per chain, in that order
+			uint64_t topology_offset;
+			uint64_t slots_offset;
+
+			uint32_t num_objects;
+			uint32_t num_springs;
+			uint32_t num_grids;
+			uint32_t num_chains;
+			uint32_t num_pieces;
+			uint32_t padding;
+
+			// frames published so far; the newest one is num_frames-1
+			std::atomic<uint64_t> num_frames;
+		};
+
+		// payload: float[3] per object, float[6] {base,goal} per chain and
+		// float[5] {quaternion xyzw,length} per piece
+		struct alignas(SECTION_ALIGNMENT) t_slot_header {
+			std::atomic<uint64_t> sequence;
+
+			uint64_t tick_index;
+			uint64_t publish_time_ns;
+		};
+	};
+
+
+	// publishes snapshots into a named shared-memory ring; export_frame is
+	// one memcpy-sized copy per tick and never blocks or allocates
+	struct t_shm_exporter {
+	public:
+		~t_shm_exporter() { stop(); }
+
+		// <shm_name> gets a leading '/' if it lacks one; the layout is sized
+		// for (and ss published as the first frame of) this topology
+		bool start(const char* shm_name, const t_state_snapshot& ss, uint32_t num_slots = shmx::DEFAULT_NUM_SLOTS);
+		// unlinks the object; readers that mapped it keep their mapping
+		void stop();
+
+		void export_frame(const t_state_snapshot& ss);
+
+		bool is_running() const { return (m_shm_addr != nullptr); }
+
+	private:
+		std::string m_shm_name;
+
+		uint8_t* m_shm_addr = nullptr;
+		shmx::t_shm_header* m_header = nullptr;
+
+		uint64_t m_num_frames = 0;
+		uint64_t m_num_skipped = 0;
+	};
+
+
+	// maps an exporter's ring read-only, e.g. to render a simulation that
+	// runs in another process
+	struct t_shm_reader {
+	public:
+		~t_shm_reader() { close(); }
+
+		bool open(const char* shm_name);
+		void close();
+
+		bool is_open() const { return (m_shm_addr != nullptr); }
+
+		// copies the newest complete frame into ss; false if nothing newer
+		// than the previous read was published (or every attempt was torn)
+		bool read_frame(t_state_snapshot& ss);
+
+		// frames published but never read because the writer was faster
+		uint64_t get_num_missed() const { return m_num_missed; }
+
+	private:
+		const uint8_t* m_shm_addr = nullptr;
+		const shmx::t_shm_header* m_header = nullptr;
+
+		uint64_t m_shm_size = 0;
+		uint64_t m_num_frames = 0;
+		uint64_t m_num_missed = 0;
+	};
+};
+
+#endif
@@ -0,0 +1,248 @@
+#include <cmath>
+
+#include "eigen_math.hpp"
+#include "profiler.hpp"
+#include "soft_renderer.hpp"
+#include "state_snapshot.hpp"
+#include "world_consts.hpp"
+
+static const uint8_t CLEAR_RGB[3] = {191, 191, 191};
+static const uint8_t GROUND_RGB[3] = {204, 204, 204};
+static const uint8_t ARM_RGB[3] = {230, 230, 230};
+static const uint8_t GOAL_RGB[3] = {204, 204, 204};
+static const uint8_t ROPE_RGB[3] = {25, 25, 25};
+
+// vertices closer than this (in clip-space w) are not projected; triangles
+// touching them are dropped instead of clipped
+static constexpr float MIN_CLIP_W = 0.01f;
+
+raster::t_renderer::t_renderer() {
+	constexpr float scale = 0.15f;
+	constexpr float angle = (2.0f * M_PI) / num_cone_divs;
+
+	// no consts::WORLD_AXES here, renderers may be constructed during static
+	// initialization (before the axes are)
+	const t_pos3f v0 = {0.0f, 0.0f, 0.0f};
+	const t_pos3f v1 = {0.0f, 0.0f, 1.0f};
+
+	for (uint32_t i = 0; i < num_cone_divs; i++) {
+		// counter-clockwise when seen from outside, as in t_render_state
+		const t_pos3f v3 = {scale * std::cos((i    ) * angle), scale * std::sin((i    ) * angle), 0.0f};
+		const t_pos3f v4 = {scale * std::cos((i + 1) * angle), scale * std::sin((i + 1) * angle), 0.0f};
+
+		m_cone_verts.insert(m_cone_verts.end(), {v3, v4, v1}); // side
+		m_cone_verts.insert(m_cone_verts.end(), {v0, v4, v3}); // base-cap
+	}
+
+	m_proj_mat = math::calc_perspective_matrix(60.0f, 1.0f, 1.0f, 100.0f);
+	m_light_dir = t_vec3f(0.3f, 1.0f, 0.6f).normalized();
+
+	set_camera({0.0f, 5.0f, 10.0f}, {0.0f, 5.0f, 9.0f});
+}
+
+void raster::t_renderer::set_camera(const t_pos3f& pos, const t_pos3f& tgt) {
+	m_view_proj_mat = m_proj_mat * math::calc_look_at_matrix(pos, tgt, t_vec3f(0.0f, 1.0f, 0.0f));
+}
+
+
+void raster::t_renderer::render(const epiks::t_state_snapshot& ss, t_framebuffer& fb) const {
+	EIGENPHYSIKS_PROFILE_ZONE("raster::render");
+
+	fb.clear(CLEAR_RGB);
+
+	{
+		const float s = consts::WORLD_PARAMS.ground_plane_scale;
+		const float y = consts::WORLD_PARAMS.ground_plane_level;
+
+		draw_triangle({-s, y,  s}, { s, y,  s}, { s, y, -s}, GROUND_RGB, fb);
+		draw_triangle({-s, y,  s}, { s, y, -s}, {-s, y, -s}, GROUND_RGB, fb);
+	}
+
+	for (const epiks::t_chain_snapshot& arm: ss.chains) {
+		t_pos3f base_pos = arm.base_pos;
+		t_mat44f scale_mat = t_mat44f::Identity();
+
+		// fixed support-piece; rotated from +z onto +y, flattened
+		const t_mat44f support_mat = (t_mat44f() <<
+			0.5f, 0.0f,  0.0f, base_pos.x(),
+			0.0f, 0.0f,  0.1f, consts::WORLD_PARAMS.ground_plane_level,
+			0.0f, -0.5f, 0.0f, base_pos.z(),
+			0.0f, 0.0f,  0.0f, 1.0f
+		).finished();
+
+		draw_mesh(support_mat, ARM_RGB, fb);
+
+		for (size_t k = 0; k < arm.num_pieces; k++) {
+			const epiks::t_piece_snapshot& j = ss.pieces[arm.piece_offset + k];
+
+			scale_mat(2, 2) = j.length;
+
+			draw_mesh(math::compose_transform_matrix(base_pos, j.rot) * scale_mat, ARM_RGB, fb);
+			base_pos = base_pos + j.rot * t_pos3f(0.0f, 0.0f, j.length);
+		}
+
+		draw_disc(arm.goal_pos, 0.1f, GOAL_RGB, fb);
+	}
+
+	for (size_t i = 0; i < ss.get_num_springs(); i++) {
+		draw_line(ss.obj_positions[ss.spring_indices[i * 2 + 0]], ss.obj_positions[ss.spring_indices[i * 2 + 1]], ROPE_RGB, fb);
+	}
+}
+
+
+raster::t_renderer::t_screen_vert raster::t_renderer::project(const t_pos3f& p, const t_framebuffer& fb) const {
+	const Eigen::Vector4f c = m_view_proj_mat * Eigen::Vector4f(p.x(), p.y(), p.z(), 1.0f);
+
+	if (c.w() < MIN_CLIP_W)
+		return {0.0f, 0.0f, 0.0f, true};
+
+	const float inv_w = 1.0f / c.w();
+
+	// pixel centers at half-integers, first row at the top
+	return {
+		(c.x() * inv_w * 0.5f + 0.5f) * fb.get_width(),
+		(0.5f - c.y() * inv_w * 0.5f) * fb.get_height(),
+		(c.z() * inv_w * 0.5f + 0.5f),
+		false,
+	};
+}
+
+void raster::t_renderer::draw_mesh(const t_mat44f& model_mat, const uint8_t rgb[3], t_framebuffer& fb) const {
+	const auto transform = [&](const t_pos3f& v) { return (t_pos3f((model_mat * Eigen::Vector4f(v.x(), v.y(), v.z(), 1.0f)).head<3>())); };
+
+	for (size_t i = 0; i < m_cone_verts.size(); i += 3) {
+		draw_triangle(transform(m_cone_verts[i + 0]), transform(m_cone_verts[i + 1]), transform(m_cone_verts[i + 2]), rgb, fb);
+	}
+}
+
+void raster::t_renderer::draw_triangle(const t_pos3f& a, const t_pos3f& b, const t_pos3f& c, const uint8_t rgb[3], t_framebuffer& fb) const {
+	const t_screen_vert v[3] = {project(a, fb), project(b, fb), project(c, fb)};
+
+	if (v[0].clipped || v[1].clipped || v[2].clipped)
+		return;
+
+	// rows grow downwards, so front faces (counter-clockwise) have negative area
+	const float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+
+	if (area >= 0.0f)
+		return;
+
+	// flat Lambert shading by the world-space face normal
+	const t_vec3f n = ((b - a).cross(c - a)).normalized();
+	const float s = 0.3f + 0.7f * std::max(n.dot(m_light_dir), 0.0f);
+	const uint8_t shaded_rgb[3] = {uint8_t(rgb[0] * s), uint8_t(rgb[1] * s), uint8_t(rgb[2] * s)};
+
+	const int32_t min_x = std::max(int32_t(std::floor(std::min({v[0].x, v[1].x, v[2].x}))), 0);
+	const int32_t min_y = std::max(int32_t(std::floor(std::min({v[0].y, v[1].y, v[2].y}))), 0);
+	const int32_t max_x = std::min(int32_t(std::ceil(std::max({v[0].x, v[1].x, v[2].x}))), int32_t(fb.get_width()) - 1);
+	const int32_t max_y = std::min(int32_t(std::ceil(std::max({v[0].y, v[1].y, v[2].y}))), int32_t(fb.get_height()) - 1);
+
+	const float inv_area = 1.0f / area;
+
+	for (int32_t y = min_y; y <= max_y; y++) {
+		for (int32_t x = min_x; x <= max_x; x++) {
+			const float px = x + 0.5f;
+			const float py = y + 0.5f;
+
+			// barycentric weights, all non-negative inside
+			const float w0 = ((v[2].x - v[1].x) * (py - v[1].y) - (v[2].y - v[1].y) * (px - v[1].x)) * inv_area;
+			const float w1 = ((v[0].x - v[2].x) * (py - v[2].y) - (v[0].y - v[2].y) * (px - v[2].x)) * inv_area;
+			const float w2 = 1.0f - w0 - w1;
+
+			if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+				continue;
+
+			// NDC depth is affine in screen space, no perspective correction needed
+			fb.plot(x, y, w0 * v[0].z + w1 * v[1].z + w2 * v[2].z, shaded_rgb);
+		}
+	}
+}
+
+void raster::t_renderer::draw_line(const t_pos3f& a, const t_pos3f& b, const uint8_t rgb[3], t_framebuffer& fb) const {
+	const t_screen_vert va = project(a, fb);
+	const t_screen_vert vb = project(b, fb);
+
+	if (va.clipped || vb.clipped)
+		return;
+
+	const float dx = vb.x - va.x;
+	const float dy = vb.y - va.y;
+	const float dz = vb.z - va.z;
+
+	// clip the parameter range to the screen (grown by the line's extra
+	// pixel) so a vertex far off-screen does not cost a step per pixel
+	const float clip_ps[4] = {-dx, dx, -dy, dy};
+	const float clip_qs[4] = {va.x + 1.0f, fb.get_width() - va.x, va.y + 1.0f, fb.get_height() - va.y};
+
+	float t0 = 0.0f;
+	float t1 = 1.0f;
+
+	for (uint32_t k = 0; k < 4; k++) {
+		if (clip_ps[k] == 0.0f) {
+			if (clip_qs[k] < 0.0f)
+				return;
+
+			continue;
+		}
+
+		if (clip_ps[k] < 0.0f) {
+			t0 = std::max(t0, clip_qs[k] / clip_ps[k]);
+		} else {
+			t1 = std::min(t1, clip_qs[k] / clip_ps[k]);
+		}
+	}
+
+	if (!(t0 <= t1))
+		return;
+
+	const int32_t num_steps = std::max(int32_t(std::ceil(std::max(std::fabs(dx), std::fabs(dy)) * (t1 - t0))), 1);
+
+	// two pixels wide, slightly in front so the line wins over coplanar faces
+	for (int32_t i = 0; i <= num_steps; i++) {
+		const float t = t0 + (t1 - t0) * (float(i) / num_steps);
+		const int32_t x = int32_t(std::floor(va.x + dx * t));
+		const int32_t y = int32_t(std::floor(va.y + dy * t));
+		const float z = va.z + dz * t - 1e-5f;
+
+		fb.plot(x    , y    , z, rgb);
+		fb.plot(x + 1, y    , z, rgb);
+		fb.plot(x    , y + 1, z, rgb);
+		fb.plot(x + 1, y + 1, z, rgb);
+	}
+}
+
+void raster::t_renderer::draw_disc(const t_pos3f& center, float radius, const uint8_t rgb[3], t_framebuffer& fb) const {
+	const Eigen::Vector4f c = m_view_proj_mat * Eigen::Vector4f(center.x(), center.y(), center.z(), 1.0f);
+
+	if (c.w() < MIN_CLIP_W)
+		return;
+
+	const t_screen_vert v = project(center, fb);
+
+	// projected sphere, shaded as if lit from the viewer
+	const float r = radius * m_proj_mat(1, 1) / c.w() * fb.get_height() * 0.5f;
+	const float inv_r = 1.0f / std::max(r, 1e-3f);
+
+	// clamped (before the float-to-int conversion) to the framebuffer, as
+	// a center just beyond MIN_CLIP_W makes r arbitrarily large
+	const int32_t min_x = std::clamp(std::floor(v.x - r), 0.0f, float(fb.get_width()));
+	const int32_t min_y = std::clamp(std::floor(v.y - r), 0.0f, float(fb.get_height()));
+	const int32_t max_x = std::clamp(std::ceil(v.x + r), -1.0f, fb.get_width() - 1.0f);
+	const int32_t max_y = std::clamp(std::ceil(v.y + r), -1.0f, fb.get_height() - 1.0f);
+
+	for (int32_t y = min_y; y <= max_y; y++) {
+		for (int32_t x = min_x; x <= max_x; x++) {
+			const float ux = (x + 0.5f - v.x) * inv_r;
+			const float uy = (y + 0.5f - v.y) * inv_r;
+			const float dsq = ux * ux + uy * uy;
+
+			if (dsq > 1.0f)
+				continue;
+
+			const float s = 0.35f + 0.65f * std::sqrt(1.0f - dsq);
+			const uint8_t shaded_rgb[3] = {uint8_t(rgb[0] * s), uint8_t(rgb[1] * s), uint8_t(rgb[2] * s)};
+
+			fb.plot(x, y, v.z, shaded_rgb);
+		}
+	}
+}
@@ -0,0 +1,105 @@
+#ifndef EIGENPHYSIKS_SOFT_RENDERER_HDR
+#define EIGENPHYSIKS_SOFT_RENDERER_HDR
+
+#include <algorithm>
+#include <vector>
+
+#include "eigen_types.hpp"
+
+namespace epiks {
+	struct t_state_snapshot;
+};
+
+// GL-free stand-in for t_render_state, for headless runs; draws the same
+// ground, arm cones, goal markers and springs into an in-memory image so
+// frames can be captured on machines without a display (or a GPU)
+namespace raster {
+	struct t_framebuffer {
+	public:
+		void resize(uint32_t width, uint32_t height) {
+			m_width = width;
+			m_height = height;
+
+			m_pixels.resize(width * height * 3);
+			m_depths.resize(width * height);
+		}
+
+		void clear(const uint8_t rgb[3]) {
+			for (size_t i = 0, n = m_depths.size(); i < n; i++) {
+				m_pixels[i * 3 + 0] = rgb[0];
+				m_pixels[i * 3 + 1] = rgb[1];
+				m_pixels[i * 3 + 2] = rgb[2];
+			}
+
+			std::fill(m_depths.begin(), m_depths.end(), 1.0f);
+		}
+
+		// depth-tested write; z is NDC depth remapped to [0, 1]
+		void plot(int32_t x, int32_t y, float z, const uint8_t rgb[3]) {
+			if (x < 0 || y < 0 || x >= int32_t(m_width) || y >= int32_t(m_height))
+				return;
+
+			const size_t i = size_t(y) * m_width + x;
+
+			if (z >= m_depths[i])
+				return;
+
+			m_depths[i] = z;
+			m_pixels[i * 3 + 0] = rgb[0];
+			m_pixels[i * 3 + 1] = rgb[1];
+			m_pixels[i * 3 + 2] = rgb[2];
+		}
+
+		uint32_t get_width() const { return m_width; }
+		uint32_t get_height() const { return m_height; }
+
+		// rows top to bottom, RGB8
+		const std::vector<uint8_t>& get_pixels() const { return m_pixels; }
+
+	private:
+		uint32_t m_width = 0;
+		uint32_t m_height = 0;
+
+		std::vector<uint8_t> m_pixels;
+		std::vector<float> m_depths;
+	};
+
+
+	struct t_renderer {
+	public:
+		t_renderer();
+
+		// defaults to the windowed camera's start position
+		void set_camera(const t_pos3f& pos, const t_pos3f& tgt);
+
+		void render(const epiks::t_state_snapshot& ss, t_framebuffer& fb) const;
+
+	private:
+		struct t_screen_vert {
+			float x;
+			float y;
+			float z;
+			bool clipped; // behind the near plane
+		};
+
+		t_screen_vert project(const t_pos3f& p, const t_framebuffer& fb) const;
+
+		void draw_mesh(const t_mat44f& model_mat, const uint8_t rgb[3], t_framebuffer& fb) const;
+		void draw_triangle(const t_pos3f& a, const t_pos3f& b, const t_pos3f& c, const uint8_t rgb[3], t_framebuffer& fb) const;
+		void draw_line(const t_pos3f& a, const t_pos3f& b, const uint8_t rgb[3], t_framebuffer& fb) const;
+		void draw_disc(const t_pos3f& center, float radius, const uint8_t rgb[3], t_framebuffer& fb) const;
+
+	private:
+		// same cone the windowed build draws; base at z=0, apex at z=1
+		static constexpr uint32_t num_cone_divs = 15;
+
+		std::vector<t_pos3f> m_cone_verts; // triangle list
+
+		t_mat44f m_proj_mat;
+		t_mat44f m_view_proj_mat;
+
+		t_vec3f m_light_dir;
+	};
+};
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef EIGENPHYSIKS_SPATIAL_HASH_HDR
+#define EIGENPHYSIKS_SPATIAL_HASH_HDR
+
+#include <cmath>
+#include <vector>
+
+#include "eigen_types.hpp"
+#include "thread_pool.hpp"
+
+namespace epiks {
+	// uniform grid of cells hashed into a fixed-size table; rebuilt from scratch
+	// in O(N) by a counting-sort so point ids in each bucket stay in index order
+	struct t_spatial_hash {
+	public:
+		template<typename t_pos_func>
+		void build(size_t num_points, float cell_size, const t_pos_func& get_pos, util::t_thread_pool& pool) {
+			size_t table_size = 1;
+
+			// keep load-factor at or below 0.5
+			while (table_size < (num_points * 2))
+				table_size <<= 1;
+
+			m_cell_size = cell_size;
+			m_inv_cell_size = 1.0f / cell_size;
+			m_table_mask = table_size - 1;
+
+			m_point_keys.resize(num_points);
+			m_point_cells.resize(num_points);
+			m_sorted_ids.resize(num_points);
+			m_bucket_offsets.assign(table_size + 1, 0);
+
+			pool.parallel_for(num_points, BUILD_CHUNK_SIZE, [&](size_t i) {
+				m_point_keys[i] = calc_key(m_point_cells[i] = calc_cell(get_pos(i)));
+			});
+
+			// histogram, exclusive prefix-sum, then scatter ids in increasing order
+			for (size_t i = 0; i < num_points; i++) {
+				m_bucket_offsets[m_point_keys[i] + 1] += 1;
+			}
+			for (size_t k = 0; k < table_size; k++) {
+				m_bucket_offsets[k + 1] += m_bucket_offsets[k];
+			}
+
+			m_bucket_fills.assign(m_bucket_offsets.begin(), m_bucket_offsets.end() - 1);
+
+			for (size_t i = 0; i < num_points; i++) {
+				m_sorted_ids[m_bucket_fills[m_point_keys[i]]++] = i;
+			}
+		}
+
+		// calls func(j) for every point id j whose cell overlaps the cube of
+		// half-size radius around pos; callers still need a distance check
+		template<typename t_func>
+		void for_each_candidate(const t_pos3f& pos, float radius, const t_func& func) const {
+			const t_vec3f ext = {radius, radius, radius};
+			const Eigen::Vector3i min_cell = calc_cell(pos - ext);
+			const Eigen::Vector3i max_cell = calc_cell(pos + ext);
+
+			Eigen::Vector3i cell;
+
+			for (cell.z() = min_cell.z(); cell.z() <= max_cell.z(); cell.z()++) {
+				for (cell.y() = min_cell.y(); cell.y() <= max_cell.y(); cell.y()++) {
+					for (cell.x() = min_cell.x(); cell.x() <= max_cell.x(); cell.x()++) {
+						const uint32_t key = calc_key(cell);
+
+						for (uint32_t k = m_bucket_offsets[key]; k < m_bucket_offsets[key + 1]; k++) {
+							const uint32_t j = m_sorted_ids[k];
+
+							// distinct cells can share a bucket; filter those out
+							// (also guarantees each id is visited at most once)
+							if (m_point_cells[j] != cell)
+								continue;
+
+							func(j);
+						}
+					}
+				}
+			}
+		}
+
+		float get_cell_size() const { return m_cell_size; }
+
+	private:
+		Eigen::Vector3i calc_cell(const t_pos3f& pos) const {
+			return {int32_t(std::floor(pos.x() * m_inv_cell_size)), int32_t(std::floor(pos.y() * m_inv_cell_size)), int32_t(std::floor(pos.z() * m_inv_cell_size))};
+		}
+
+		uint32_t calc_key(const Eigen::Vector3i& cell) const {
+			const uint32_t hx = uint32_t(cell.x()) * 73856093u;
+			const uint32_t hy = uint32_t(cell.y()) * 19349663u;
+			const uint32_t hz = uint32_t(cell.z()) * 83492791u;
+			return ((hx ^ hy ^ hz) & m_table_mask);
+		}
+
+	private:
+		static constexpr size_t BUILD_CHUNK_SIZE = 1024;
+
+		std::vector<Eigen::Vector3i> m_point_cells;
+		std::vector<uint32_t> m_point_keys;
+		std::vector<uint32_t> m_sorted_ids;
+		std::vector<uint32_t> m_bucket_offsets;
+		std::vector<uint32_t> m_bucket_fills;
+
+		float m_cell_size = 1.0f;
+		float m_inv_cell_size = 1.0f;
+
+		uint32_t m_table_mask = 0;
+	};
+};
+
+#endif
@@ -0,0 +1,360 @@
+#include <algorithm>
+#include <cmath>
+
+#include "env_force_kernel.hpp"
+#include "spring_world.hpp"
+#include "profiler.hpp"
+#include "telemetry.hpp"
+
+static const util::t_telem_series TELEM_KINETIC_ENERGY("springs::kinetic_energy", util::t_telem_series::KIND_VALUE, 1e-6);
+static const util::t_telem_series TELEM_MAX_STRAIN("springs::max_strain", util::t_telem_series::KIND_VALUE, 1e-6);
+static const util::t_telem_series TELEM_NONFINITE("springs::nonfinite", util::t_telem_series::KIND_COUNTER);
+
+size_t epiks::t_spring_world::add_grid(const t_spring_grid& grid) {
+	const size_t grid_idx = m_grids.size();
+	const size_t obj_offset = m_positions.size();
+	const size_t num_objects = grid.get_num_objects();
+
+	const float mass = grid.get_grid_params().link_mass;
+
+	m_grids.push_back(grid);
+
+	t_spring_grid& g = m_grids.back();
+
+	// offsets must be known before the grid can emit world-space springs
+	g.set_ranges(obj_offset, m_springs.size(), 0);
+	g.add_springs(m_springs);
+	g.set_ranges(obj_offset, g.get_spring_offset(), m_springs.size() - g.get_spring_offset());
+
+	for (size_t i = 0; i < num_objects; i++) {
+		m_positions.push_back(g.calc_rest_pos(i));
+		m_velocities.push_back({0.0f, 0.0f, 0.0f});
+		m_forces.push_back(t_vec3a::Zero());
+		m_pulling_accs.push_back({0.0f, 0.0f, 0.0f});
+		m_raw_masses.push_back(mass);
+		m_inv_masses.push_back(1.0f / mass);
+		m_grid_indices.push_back(grid_idx);
+	}
+
+	m_max_thickness = std::max(m_max_thickness, g.get_base_params().thickness);
+	m_adjacency_dirty = true;
+	return grid_idx;
+}
+
+
+void epiks::t_spring_world::restore(
+	const std::vector<t_spring_grid>& grids,
+	const std::vector<t_spring_object>& springs,
+	const t_pos3f* positions,
+	const t_vec3f* velocities,
+	size_t num_objects
+) {
+	m_grids = grids;
+	m_springs = springs;
+
+	m_positions.assign(positions, positions + num_objects);
+	m_velocities.assign(velocities, velocities + num_objects);
+	m_forces.assign(num_objects, t_vec3a::Zero());
+	m_pulling_accs.assign(num_objects, {0.0f, 0.0f, 0.0f});
+
+	m_raw_masses.resize(num_objects);
+	m_inv_masses.resize(num_objects);
+	m_grid_indices.resize(num_objects);
+
+	m_max_thickness = 0.0f;
+
+	for (size_t grid_idx = 0; grid_idx < m_grids.size(); grid_idx++) {
+		const t_spring_grid& g = m_grids[grid_idx];
+		const float mass = g.get_grid_params().link_mass;
+
+		assert((g.get_obj_offset() + g.get_num_objects()) <= num_objects);
+
+		std::fill(m_raw_masses.begin() + g.get_obj_offset(), m_raw_masses.begin() + g.get_obj_offset() + g.get_num_objects(), mass);
+		std::fill(m_inv_masses.begin() + g.get_obj_offset(), m_inv_masses.begin() + g.get_obj_offset() + g.get_num_objects(), 1.0f / mass);
+		std::fill(m_grid_indices.begin() + g.get_obj_offset(), m_grid_indices.begin() + g.get_obj_offset() + g.get_num_objects(), grid_idx);
+
+		m_max_thickness = std::max(m_max_thickness, g.get_base_params().thickness);
+	}
+
+	m_adjacency_dirty = true;
+}
+
+
+void epiks::t_spring_world::update(float dt, util::t_thread_pool& thread_pool) {
+	EIGENPHYSIKS_PROFILE_ZONE("springs::update");
+
+	if (m_adjacency_dirty)
+		build_adjacency();
+
+	solve_spring_forces(thread_pool);
+
+	// add self-collision forces
+	if (m_max_thickness > 0.0f)
+		build_self_coll_hash(thread_pool);
+
+	// add static-geometry contact forces; queries are batched over all objects
+	if (m_static_geometry != nullptr && !m_static_geometry->empty()) {
+		EIGENPHYSIKS_PROFILE_ZONE("springs::contacts");
+
+		m_contacts.resize(m_positions.size());
+		m_static_geometry->query_points(m_positions.size(), [&](size_t i) { return m_positions[i]; }, m_contacts.data(), thread_pool);
+	}
+
+	solve_object_forces(thread_pool);
+	apply_forces(dt, thread_pool);
+	update_anchors(dt);
+
+	// a NaN or infinite energy (or strain) means the grid has blown up
+	if (!std::isfinite(m_kinetic_energy) || !std::isfinite(m_max_strain))
+		EIGENPHYSIKS_TELEM_COUNT(TELEM_NONFINITE, 1);
+
+	EIGENPHYSIKS_TELEM_VALUE(TELEM_KINETIC_ENERGY, m_kinetic_energy);
+	EIGENPHYSIKS_TELEM_VALUE(TELEM_MAX_STRAIN, m_max_strain);
+}
+
+
+void epiks::t_spring_world::build_adjacency() {
+	m_adj_offsets.assign(m_positions.size() + 1, 0);
+	m_adj_springs.resize(m_springs.size() * 2);
+
+	for (const t_spring_object& s: m_springs) {
+		m_adj_offsets[s.get_lhs_obj_idx() + 1] += 1;
+		m_adj_offsets[s.get_rhs_obj_idx() + 1] += 1;
+	}
+	for (size_t i = 0; i < m_positions.size(); i++) {
+		m_adj_offsets[i + 1] += m_adj_offsets[i];
+	}
+
+	std::vector<uint32_t> fills(m_adj_offsets.begin(), m_adj_offsets.end() - 1);
+
+	for (size_t i = 0; i < m_springs.size(); i++) {
+		m_adj_springs[fills[m_springs[i].get_lhs_obj_idx()]++] = (i << 1) | 0;
+		m_adj_springs[fills[m_springs[i].get_rhs_obj_idx()]++] = (i << 1) | 1;
+	}
+
+	m_spring_forces.resize(m_springs.size());
+	m_adjacency_dirty = false;
+}
+
+void epiks::t_spring_world::build_self_coll_hash(util::t_thread_pool& thread_pool) {
+	EIGENPHYSIKS_PROFILE_ZONE("springs::self_coll_hash");
+
+	// cells twice as wide as the contact distance, so at most 2x2x2 are visited per query
+	m_self_coll_hash.build(m_positions.size(), m_max_thickness * 2.0f, [&](size_t i) { return m_positions[i]; }, thread_pool);
+}
+
+
+void epiks::t_spring_world::solve_spring_forces(util::t_thread_pool& thread_pool) {
+	EIGENPHYSIKS_PROFILE_ZONE("springs::spring_forces");
+
+	const size_t num_springs = m_springs.size();
+	const size_t num_chunks = (num_springs + SPRING_CHUNK_SIZE - 1) / SPRING_CHUNK_SIZE;
+
+	m_chunk_strains.resize(num_chunks);
+
+	// one item per chunk, so each chunk can also track its maximum strain
+	thread_pool.parallel_for(num_chunks, 1, [&](size_t c) {
+		float max_strain = 0.0f;
+
+		for (size_t i = c * SPRING_CHUNK_SIZE, n = std::min(i + SPRING_CHUNK_SIZE, num_springs); i < n; i++) {
+			const t_spring_object& s = m_springs[i];
+			const t_spring_base_params& sp = m_grids[m_grid_indices[s.get_lhs_obj_idx()]].get_base_params();
+
+			t_accum_real cur_length = 0;
+
+			m_spring_forces[i] = s.calc_force<t_accum_real>(m_positions.data(), m_velocities.data(), sp, &cur_length);
+
+			if (sp.rest_length > 0.0f)
+				max_strain = std::max(max_strain, float(std::abs(cur_length - sp.rest_length) / sp.rest_length));
+		}
+
+		m_chunk_strains[c] = max_strain;
+	});
+
+	m_max_strain = 0.0f;
+
+	for (float strain: m_chunk_strains) {
+		m_max_strain = std::max(m_max_strain, strain);
+	}
+}
+
+void epiks::t_spring_world::solve_object_forces(util::t_thread_pool& thread_pool) {
+	EIGENPHYSIKS_PROFILE_ZONE("springs::object_forces");
+
+	const bool self_collide = (m_max_thickness > 0.0f);
+	const bool static_collide = (m_static_geometry != nullptr && !m_static_geometry->empty());
+
+	const size_t num_objects = m_positions.size();
+	const size_t num_chunks = (num_objects + OBJECT_CHUNK_SIZE - 1) / OBJECT_CHUNK_SIZE;
+
+	const t_env_force_kernel env_force_kernel = get_env_force_kernel();
+
+	thread_pool.parallel_for(num_chunks, 1, [&](size_t c) {
+		typedef t_accum_real t_real;
+
+		const size_t chunk_beg = c * OBJECT_CHUNK_SIZE;
+		const size_t chunk_end = std::min(chunk_beg + OBJECT_CHUNK_SIZE, num_objects);
+
+		for (size_t i = chunk_beg; i < chunk_end; i++) {
+			const t_real m = m_raw_masses[i];
+
+			t_vec3a f = {t_real(0), t_real(0), t_real(0)};
+
+			// add internal spring forces
+			for (uint32_t k = m_adj_offsets[i]; k < m_adj_offsets[i + 1]; k++) {
+				const uint32_t ref = m_adj_springs[k];
+				const t_vec3a& sf = m_spring_forces[ref >> 1];
+
+				f += ((ref & 1)? t_vec3a(-sf): sf);
+			}
+
+			if (self_collide)
+				f += calc_self_coll_force(i).cast<t_real>();
+
+			// add pulling force, F = m*a
+			f += (m_pulling_accs[i].cast<t_real>() * m);
+
+			m_forces[i] = f;
+			m_pulling_accs[i] = {0.0f, 0.0f, 0.0f};
+		}
+
+		// add common (gravity, air and ground) forces over every grid's slice
+		// of this chunk; grids own contiguous object ranges
+		for (const t_spring_grid& g: m_grids) {
+			const size_t beg = std::max(chunk_beg, g.get_obj_offset());
+			const size_t end = std::min(chunk_end, g.get_obj_offset() + g.get_num_objects());
+
+			if (beg >= end)
+				continue;
+
+			env_force_kernel(
+				m_forces[beg].data(),
+				m_positions[beg].data(),
+				m_velocities[beg].data(),
+				&m_raw_masses[beg],
+				end - beg,
+				g.get_grid_params().gravity_acc,
+				g.get_world_params()
+			);
+		}
+
+		if (!static_collide)
+			return;
+
+		for (size_t i = chunk_beg; i < chunk_end; i++) {
+			if (m_contacts[i].depth > 0.0f)
+				m_forces[i] += calc_contact_force(m_velocities[i], m_contacts[i], m_grids[m_grid_indices[i]].get_world_params()).cast<t_real>();
+		}
+	});
+}
+
+t_vec3f epiks::t_spring_world::calc_self_coll_force(size_t lhs_idx) const {
+	const t_spring_grid& lhs_grid = m_grids[m_grid_indices[lhs_idx]];
+	const t_spring_base_params& lhs_sp = lhs_grid.get_base_params();
+
+	const size_t num_links_x = lhs_grid.get_grid_params().num_links_x;
+	const size_t lhs_x = (lhs_idx - lhs_grid.get_obj_offset()) % num_links_x;
+	const size_t lhs_y = (lhs_idx - lhs_grid.get_obj_offset()) / num_links_x;
+
+	t_vec3f force = {0.0f, 0.0f, 0.0f};
+
+	// each object gathers the forces from all of its overlapping neighbors
+	// into its own slot, so the result does not depend on thread timing
+	// candidates come from the world-wide radius, since a thin grid still
+	// collides with (and is pushed back by) a thick one
+	m_self_coll_hash.for_each_candidate(m_positions[lhs_idx], m_max_thickness, [&](size_t rhs_idx) {
+		if (m_grid_indices[rhs_idx] == m_grid_indices[lhs_idx]) {
+			const size_t rhs_x = (rhs_idx - lhs_grid.get_obj_offset()) % num_links_x;
+			const size_t rhs_y = (rhs_idx - lhs_grid.get_obj_offset()) / num_links_x;
+
+			// skip self and directly connected neighbors, springs handle those
+			if (std::max(lhs_x, rhs_x) - std::min(lhs_x, rhs_x) <= 1 && std::max(lhs_y, rhs_y) - std::min(lhs_y, rhs_y) <= 1)
+				return;
+		}
+
+		const t_spring_base_params& rhs_sp = m_grids[m_grid_indices[rhs_idx]].get_base_params();
+
+		// pair parameters are symmetric, so both sides see equal and opposite
+		// forces; the thicker grid sets the contact distance
+		const float thickness = std::max(lhs_sp.thickness, rhs_sp.thickness);
+		const float stiff_const = (lhs_sp.stiff_const + rhs_sp.stiff_const) * 0.5f;
+		const float frict_const = (lhs_sp.frict_const + rhs_sp.frict_const) * 0.5f;
+
+		const t_vec3f dif_pos = m_positions[lhs_idx] - m_positions[rhs_idx];
+		const float dist_sq = dif_pos.dot(dif_pos);
+
+		if (dist_sq >= (thickness * thickness) || dist_sq <= 0.0f)
+			return;
+
+		const float dist = std::sqrt(dist_sq);
+		const t_vec3f normal = dif_pos / dist;
+		const float nrm_speed = (m_velocities[lhs_idx] - m_velocities[rhs_idx]).dot(normal);
+
+		// push apart like a compressed spring, damp only approaching motion
+		force += (normal * (stiff_const * (thickness - dist)));
+		force -= (normal * (frict_const * nrm_speed * (nrm_speed < 0.0f)));
+	});
+
+	return force;
+}
+
+
+void epiks::t_spring_world::apply_forces(float dt, util::t_thread_pool& thread_pool) {
+	EIGENPHYSIKS_PROFILE_ZONE("springs::integrate");
+
+	const size_t num_objects = m_positions.size();
+	const size_t num_chunks = (num_objects + OBJECT_CHUNK_SIZE - 1) / OBJECT_CHUNK_SIZE;
+
+	m_chunk_energies.resize(num_chunks);
+
+	// one item per chunk, so each chunk can also sum its kinetic energy
+	thread_pool.parallel_for(num_chunks, 1, [&](size_t c) {
+		typedef t_accum_real t_real;
+
+		double energy = 0.0;
+
+		for (size_t i = c * OBJECT_CHUNK_SIZE, n = std::min(i + OBJECT_CHUNK_SIZE, num_objects); i < n; i++) {
+			// with double accumulation only the stored results are rounded to float
+			const t_vec3a vel = m_velocities[i].cast<t_real>() + ((m_forces[i] * t_real(m_inv_masses[i])) * t_real(dt));
+			const t_vec3a pos = m_positions[i].cast<t_real>() + (vel * t_real(dt));
+
+			m_velocities[i] = vel.cast<float>();
+			m_positions[i] = pos.cast<float>();
+
+			energy += (0.5 * m_raw_masses[i] * double(vel.squaredNorm()));
+
+			assert(!std::isnan(m_positions[i].x()) && !std::isnan(m_positions[i].y()) && !std::isnan(m_positions[i].z()));
+			assert(!std::isnan(m_velocities[i].x()) && !std::isnan(m_velocities[i].y()) && !std::isnan(m_velocities[i].z()));
+		}
+
+		m_chunk_energies[c] = energy;
+	});
+
+	m_kinetic_energy = 0.0;
+
+	for (double energy: m_chunk_energies) {
+		m_kinetic_energy += energy;
+	}
+}
+
+void epiks::t_spring_world::update_anchors(float dt) {
+	for (t_spring_grid& g: m_grids) {
+		const t_world_params& wp = g.get_world_params();
+
+		for (size_t i = 0; i < g.get_num_anchors(); i++) {
+			t_spring_anchor& anchor = g.get_anchor(i);
+
+			t_pos3f& pos = anchor.pos;
+			t_vec3f& vel = anchor.vel;
+
+			pos += (vel * dt);
+			vel *= 0.85f;
+
+			vel.y() *=         (pos.y() >= wp.ground_plane_level);
+			pos.y()  = std::max(pos.y(),   wp.ground_plane_level);
+
+			m_positions[g.get_obj_offset() + anchor.obj_idx] = pos;
+			m_velocities[g.get_obj_offset() + anchor.obj_idx] = vel;
+		}
+	}
+}
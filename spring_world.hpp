@@ -0,0 +1,117 @@
+#ifndef EIGENPHYSIKS_SPRING_WORLD_HDR
+#define EIGENPHYSIKS_SPRING_WORLD_HDR
+
+#include <vector>
+
+#include "eigen_types.hpp"
+#include "spatial_hash.hpp"
+#include "spring_grid.hpp"
+#include "static_geometry.hpp"
+#include "thread_pool.hpp"
+
+namespace epiks {
+	// owns the objects and springs of every grid as one set of flat arrays
+	// (structure-of-arrays) and steps all of them together; object indices
+	// are world-space unless a function says otherwise
+	struct t_spring_world {
+	public:
+		// grid must have its anchors set; returns the index of the grid
+		size_t add_grid(const t_spring_grid& grid);
+
+		// replaces all contents; grids must already have their ranges set and
+		// springs must use world-space indices (e.g. as saved in a checkpoint)
+		void restore(
+			const std::vector<t_spring_grid>& grids,
+			const std::vector<t_spring_object>& springs,
+			const t_pos3f* positions,
+			const t_vec3f* velocities,
+			size_t num_objects
+		);
+
+		void update(float dt, util::t_thread_pool& thread_pool);
+
+		// geometry is not owned, nullptr disables collisions with it
+		void set_static_geometry(const t_static_geometry* geom) { m_static_geometry = geom; }
+
+		size_t get_num_grids() const { return (m_grids.size()); }
+		size_t get_num_objects() const { return (m_positions.size()); }
+		size_t get_num_springs() const { return (m_springs.size()); }
+
+		const t_spring_grid& get_grid(size_t i) const { return m_grids[i]; }
+		      t_spring_grid& get_grid(size_t i)       { return m_grids[i]; }
+
+		const t_spring_object& get_spring(size_t i) const { return m_springs[i]; }
+
+		const t_pos3f& get_pos(size_t i) const { return m_positions[i]; }
+		const t_vec3f& get_vel(size_t i) const { return m_velocities[i]; }
+
+		const t_pos3f* get_positions() const { return (m_positions.data()); }
+		const t_vec3f* get_velocities() const { return (m_velocities.data()); }
+
+		size_t get_obj_idx(size_t grid_idx, size_t grid_obj_idx) const { return (m_grids[grid_idx].get_obj_offset() + grid_obj_idx); }
+
+		// consumed by the next update
+		void add_pulling_acc(size_t obj_idx, const t_vec3f& acc) { m_pulling_accs[obj_idx] += acc; }
+
+		// gauges measured during the last update; kinetic energy is summed over
+		// all objects after integration, strain is |length - rest| / rest
+		double get_kinetic_energy() const { return m_kinetic_energy; }
+		float get_max_strain() const { return m_max_strain; }
+
+	private:
+		void build_adjacency();
+		void build_self_coll_hash(util::t_thread_pool& thread_pool);
+
+		void solve_spring_forces(util::t_thread_pool& thread_pool);
+		void solve_object_forces(util::t_thread_pool& thread_pool);
+		void apply_forces(float dt, util::t_thread_pool& thread_pool);
+		void update_anchors(float dt);
+
+		t_vec3f calc_self_coll_force(size_t obj_idx) const;
+
+	private:
+		// forces are accumulated and integrated in t_accum_real (see eigen_types.hpp)
+		typedef t_vec3<t_accum_real> t_vec3a;
+
+		static constexpr size_t OBJECT_CHUNK_SIZE = 512;
+		static constexpr size_t SPRING_CHUNK_SIZE = 1024;
+
+		std::vector<t_spring_grid> m_grids;
+		std::vector<t_spring_object> m_springs;
+
+		// per-object attributes
+		std::vector<t_pos3f> m_positions;
+		std::vector<t_vec3f> m_velocities;
+		std::vector<t_vec3a> m_forces;
+		std::vector<t_vec3f> m_pulling_accs;
+		std::vector<float> m_raw_masses;
+		std::vector<float> m_inv_masses;
+		std::vector<uint32_t> m_grid_indices;
+
+		// per-spring lhs forces, gathered per object through the adjacency
+		// lists (so the spring pass never scatters into shared objects)
+		std::vector<t_vec3a> m_spring_forces;
+		std::vector<uint32_t> m_adj_offsets;
+		std::vector<uint32_t> m_adj_springs; // (spring index << 1) | is_rhs
+
+		std::vector<t_coll_contact> m_contacts;
+
+		// per-chunk partial gauges, reduced in chunk order so the totals do
+		// not depend on which thread ran which chunk
+		std::vector<double> m_chunk_energies;
+		std::vector<float> m_chunk_strains;
+
+		t_spatial_hash m_self_coll_hash;
+
+		const t_static_geometry* m_static_geometry = nullptr;
+
+		float m_max_thickness = 0.0f;
+		float m_max_strain = 0.0f;
+
+		double m_kinetic_energy = 0.0;
+
+		bool m_adjacency_dirty = true;
+	};
+};
+
+#endif
@@ -0,0 +1,78 @@
+#include "state_snapshot.hpp"
+#include "eigen_math.hpp"
+#include "physics_state.hpp"
+
+void epiks::t_state_snapshot::capture(const t_physics_state& ps, uint64_t tick) {
+	const epiks::t_spring_world& world = ps.get_spring_world();
+
+	tick_index = tick;
+
+	obj_positions.assign(world.get_positions(), world.get_positions() + world.get_num_objects());
+
+	// topology is static, only copy it into slots that have not seen it yet
+	if (spring_indices.size() != (world.get_num_springs() * 2)) {
+		spring_indices.clear();
+		spring_indices.reserve(world.get_num_springs() * 2);
+
+		for (size_t i = 0; i < world.get_num_springs(); i++) {
+			spring_indices.push_back(world.get_spring(i).get_lhs_obj_idx());
+			spring_indices.push_back(world.get_spring(i).get_rhs_obj_idx());
+		}
+	}
+	if (grid_tail_indices.size() != world.get_num_grids()) {
+		grid_tail_indices.clear();
+
+		for (size_t i = 0; i < world.get_num_grids(); i++) {
+			grid_tail_indices.push_back(world.get_obj_idx(i, world.get_grid(i).get_tail_obj_idx()));
+		}
+	}
+
+	chains.clear();
+	pieces.clear();
+
+	for (size_t i = 0; i < ps.get_num_chains(); i++) {
+		const epiks::t_rb_chain& chain = ps.get_chain(i);
+
+		chains.push_back({chain.get_base_pos(), chain.get_goal_pos(), uint32_t(pieces.size()), uint32_t(chain.get_num_pieces())});
+
+		for (const epiks::t_rb_piece& piece: chain.get_pieces()) {
+			pieces.push_back({piece.get_transform(), piece.get_length()});
+		}
+	}
+}
+
+void epiks::t_state_snapshot::copy_state(const t_state_snapshot& ss) {
+	tick_index = ss.tick_index;
+	publish_time_ns = ss.publish_time_ns;
+
+	obj_positions.assign(ss.obj_positions.begin(), ss.obj_positions.end());
+
+	if (spring_indices.size() != ss.spring_indices.size())
+		spring_indices.assign(ss.spring_indices.begin(), ss.spring_indices.end());
+	if (grid_tail_indices.size() != ss.grid_tail_indices.size())
+		grid_tail_indices.assign(ss.grid_tail_indices.begin(), ss.grid_tail_indices.end());
+
+	chains.assign(ss.chains.begin(), ss.chains.end());
+	pieces.assign(ss.pieces.begin(), ss.pieces.end());
+}
+
+void epiks::t_state_snapshot::interpolate(const t_state_snapshot& a, const t_state_snapshot& b, float alpha) {
+	copy_state(b);
+
+	// scene changed between the two ticks, nothing sensible to blend
+	if (a.obj_positions.size() != b.obj_positions.size() || a.pieces.size() != b.pieces.size() || a.chains.size() != b.chains.size())
+		return;
+
+	for (size_t i = 0; i < obj_positions.size(); i++) {
+		obj_positions[i] = a.obj_positions[i] + (b.obj_positions[i] - a.obj_positions[i]) * alpha;
+	}
+
+	for (size_t i = 0; i < chains.size(); i++) {
+		chains[i].base_pos = a.chains[i].base_pos + (b.chains[i].base_pos - a.chains[i].base_pos) * alpha;
+		chains[i].goal_pos = a.chains[i].goal_pos + (b.chains[i].goal_pos - a.chains[i].goal_pos) * alpha;
+	}
+
+	for (size_t i = 0; i < pieces.size(); i++) {
+		pieces[i].rot = math::slerp_rotation(a.pieces[i].rot, b.pieces[i].rot, alpha);
+	}
+}
@@ -0,0 +1,56 @@
+#ifndef EIGENPHYSIKS_STATE_SNAPSHOT_HDR
+#define EIGENPHYSIKS_STATE_SNAPSHOT_HDR
+
+#include <vector>
+
+#include "eigen_types.hpp"
+
+namespace epiks {
+	struct t_physics_state;
+
+	struct t_piece_snapshot {
+		t_rot4f rot;
+		float length;
+	};
+
+	struct t_chain_snapshot {
+		t_pos3f base_pos;
+		t_pos3f goal_pos;
+
+		uint32_t piece_offset;
+		uint32_t num_pieces;
+	};
+
+	// immutable (once published) copy of everything the renderer needs
+	// from one physics tick; capture reuses existing storage so it stops
+	// allocating after the first few ticks
+	struct t_state_snapshot {
+	public:
+		void capture(const t_physics_state& ps, uint64_t tick_index);
+
+		// copies another snapshot; its (static) topology only if this one
+		// has not seen it yet, so per-frame copies are just the dynamic state
+		void copy_state(const t_state_snapshot& ss);
+
+		// blends two captures of the same scene; alpha=0 yields a, alpha=1 yields b
+		// positions are lerped and piece rotations slerped, topology comes from b
+		void interpolate(const t_state_snapshot& a, const t_state_snapshot& b, float alpha);
+
+		size_t get_num_objects() const { return (obj_positions.size()); }
+		size_t get_num_springs() const { return (spring_indices.size() >> 1); }
+		size_t get_num_chains() const { return (chains.size()); }
+
+	public:
+		uint64_t tick_index = 0;
+		uint64_t publish_time_ns = 0; // steady-clock time at which the tick finished
+
+		std::vector<t_pos3f> obj_positions;
+		std::vector<uint32_t> spring_indices; // {lhs,rhs} object pairs
+		std::vector<uint32_t> grid_tail_indices;
+
+		std::vector<t_chain_snapshot> chains;
+		std::vector<t_piece_snapshot> pieces;
+	};
+};
+
+#endif
@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <limits>
+
+#include "static_geometry.hpp"
+
+static t_pos3f closest_segment_pos(const t_pos3f& p, const t_pos3f& a, const t_pos3f& b) {
+	const t_vec3f ab = b - a;
+	const float len_sq = ab.dot(ab);
+
+	if (len_sq <= 0.0f)
+		return a;
+
+	return (a + ab * std::max(0.0f, std::min(1.0f, (p - a).dot(ab) / len_sq)));
+}
+
+static bool calc_sphere_contact(const t_pos3f& p, const t_pos3f& c, float r, epiks::t_coll_contact& contact) {
+	const t_vec3f v = p - c;
+	const float d = v.norm();
+
+	if (d >= r)
+		return false;
+
+	// degenerate case (point exactly at center), push it upward
+	contact.normal = (d > 0.0f)? t_vec3f(v / d): consts::WORLD_AXES[consts::AXIS_IDX_Y];
+	contact.depth = r - d;
+	return true;
+}
+
+
+
+void epiks::t_static_geometry::add_mesh(const std::vector<t_pos3f>& verts, const std::vector<uint32_t>& indices, float skin_depth) {
+	assert((indices.size() % 3) == 0);
+
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		t_coll_triangle tri;
+
+		tri.verts[0] = verts[indices[i + 0]];
+		tri.verts[1] = verts[indices[i + 1]];
+		tri.verts[2] = verts[indices[i + 2]];
+		tri.normal = ((tri.verts[1] - tri.verts[0]).cross(tri.verts[2] - tri.verts[0])).normalized();
+		tri.skin_depth = skin_depth;
+
+		add_prim(PRIM_TYPE_TRIANGLE, m_triangles.size());
+		m_triangles.push_back(tri);
+	}
+}
+
+void epiks::t_static_geometry::clear() {
+	m_spheres.clear();
+	m_capsules.clear();
+	m_boxes.clear();
+	m_triangles.clear();
+
+	m_prim_refs.clear();
+	m_bvh_nodes.clear();
+}
+
+void epiks::t_static_geometry::build() {
+	m_bvh_nodes.clear();
+
+	if (m_prim_refs.empty())
+		return;
+
+	// bounds are indexed by prim-ref; reordered along with the refs during build
+	std::vector<t_aabb> prim_boxes;
+	prim_boxes.reserve(m_prim_refs.size());
+
+	for (const t_prim_ref& ref: m_prim_refs) {
+		prim_boxes.push_back(calc_prim_bbox(ref));
+	}
+
+	// a binary tree with N leaves has at most 2N-1 nodes
+	m_bvh_nodes.reserve(m_prim_refs.size() * 2);
+	m_bvh_nodes.emplace_back();
+
+	build_node(0, 0, m_prim_refs.size(), prim_boxes);
+}
+
+void epiks::t_static_geometry::build_node(size_t node_idx, size_t min_ref_idx, size_t max_ref_idx, std::vector<t_aabb>& prim_boxes) {
+	t_aabb node_bbox;
+	t_aabb cent_bbox;
+
+	for (size_t i = min_ref_idx; i < max_ref_idx; i++) {
+		node_bbox.add_box(prim_boxes[i]);
+		cent_bbox.add_pos(prim_boxes[i].get_center());
+	}
+
+	m_bvh_nodes[node_idx].bbox = node_bbox;
+
+	if ((max_ref_idx - min_ref_idx) <= MAX_LEAF_PRIMS) {
+		m_bvh_nodes[node_idx].first_idx = min_ref_idx;
+		m_bvh_nodes[node_idx].num_prims = max_ref_idx - min_ref_idx;
+		return;
+	}
+
+	// median split along the axis of largest centroid spread
+	const t_vec3f ext = cent_bbox.get_extent();
+	const size_t axis = (ext.x() >= ext.y() && ext.x() >= ext.z())? consts::AXIS_IDX_X: ((ext.y() >= ext.z())? consts::AXIS_IDX_Y: consts::AXIS_IDX_Z);
+	const size_t mid_ref_idx = (min_ref_idx + max_ref_idx) >> 1;
+
+	{
+		std::vector<size_t> order(max_ref_idx - min_ref_idx);
+		std::vector<t_prim_ref> refs(order.size());
+		std::vector<t_aabb> boxes(order.size());
+
+		for (size_t i = 0; i < order.size(); i++) {
+			order[i] = min_ref_idx + i;
+		}
+
+		const auto cmp_centers = [&](size_t a, size_t b) { return (prim_boxes[a].get_center()[axis] < prim_boxes[b].get_center()[axis]); };
+
+		std::nth_element(order.begin(), order.begin() + (mid_ref_idx - min_ref_idx), order.end(), cmp_centers);
+
+		for (size_t i = 0; i < order.size(); i++) {
+			refs[i] = m_prim_refs[order[i]];
+			boxes[i] = prim_boxes[order[i]];
+		}
+
+		std::copy(refs.begin(), refs.end(), m_prim_refs.begin() + min_ref_idx);
+		std::copy(boxes.begin(), boxes.end(), prim_boxes.begin() + min_ref_idx);
+	}
+
+	// siblings are allocated together so they end up adjacent
+	const size_t lhs_idx = m_bvh_nodes.size();
+	const size_t rhs_idx = lhs_idx + 1;
+
+	m_bvh_nodes[node_idx].first_idx = lhs_idx;
+	m_bvh_nodes[node_idx].num_prims = 0;
+
+	m_bvh_nodes.emplace_back();
+	m_bvh_nodes.emplace_back();
+
+	build_node(lhs_idx, min_ref_idx, mid_ref_idx, prim_boxes);
+	build_node(rhs_idx, mid_ref_idx, max_ref_idx, prim_boxes);
+}
+
+
+
+bool epiks::t_static_geometry::query_point(const t_pos3f& pos, t_coll_contact& contact) const {
+	if (m_bvh_nodes.empty())
+		return false;
+
+	// tree depth is logarithmic in the number of primitives
+	uint32_t node_stack[64];
+	uint32_t stack_size = 0;
+
+	t_coll_contact prim_contact;
+
+	contact.depth = 0.0f;
+	node_stack[stack_size++] = 0;
+
+	while (stack_size > 0) {
+		const t_bvh_node& node = m_bvh_nodes[node_stack[--stack_size]];
+
+		if (!node.bbox.contains(pos))
+			continue;
+
+		if (node.num_prims == 0) {
+			node_stack[stack_size++] = node.first_idx + 0;
+			node_stack[stack_size++] = node.first_idx + 1;
+			continue;
+		}
+
+		for (uint32_t i = node.first_idx; i < (node.first_idx + node.num_prims); i++) {
+			if (!calc_prim_contact(m_prim_refs[i], pos, prim_contact))
+				continue;
+			if (prim_contact.depth <= contact.depth)
+				continue;
+
+			contact = prim_contact;
+		}
+	}
+
+	return (contact.depth > 0.0f);
+}
+
+
+
+epiks::t_aabb epiks::t_static_geometry::calc_prim_bbox(const t_prim_ref& ref) const {
+	t_aabb bbox;
+
+	switch (ref.type) {
+		case PRIM_TYPE_SPHERE: {
+			const t_coll_sphere& s = m_spheres[ref.index];
+			const t_vec3f r = {s.radius, s.radius, s.radius};
+
+			bbox = t_aabb(s.pos - r, s.pos + r);
+		} break;
+		case PRIM_TYPE_CAPSULE: {
+			const t_coll_capsule& c = m_capsules[ref.index];
+			const t_vec3f r = {c.radius, c.radius, c.radius};
+
+			bbox = t_aabb(c.pos0.cwiseMin(c.pos1) - r, c.pos0.cwiseMax(c.pos1) + r);
+		} break;
+		case PRIM_TYPE_BOX: {
+			const t_coll_box& b = m_boxes[ref.index];
+			const t_vec3f e = b.rot.toRotationMatrix().cwiseAbs() * b.half_ext;
+
+			bbox = t_aabb(b.pos - e, b.pos + e);
+		} break;
+		case PRIM_TYPE_TRIANGLE: {
+			const t_coll_triangle& t = m_triangles[ref.index];
+
+			for (const t_pos3f& v: t.verts) {
+				bbox.add_pos(v);
+				bbox.add_pos(v - t.normal * t.skin_depth);
+			}
+		} break;
+		default: {
+			assert(false);
+		} break;
+	}
+
+	return bbox;
+}
+
+bool epiks::t_static_geometry::calc_prim_contact(const t_prim_ref& ref, const t_pos3f& pos, t_coll_contact& contact) const {
+	switch (ref.type) {
+		case PRIM_TYPE_SPHERE: {
+			const t_coll_sphere& s = m_spheres[ref.index];
+			return (calc_sphere_contact(pos, s.pos, s.radius, contact));
+		} break;
+		case PRIM_TYPE_CAPSULE: {
+			const t_coll_capsule& c = m_capsules[ref.index];
+			return (calc_sphere_contact(pos, closest_segment_pos(pos, c.pos0, c.pos1), c.radius, contact));
+		} break;
+		case PRIM_TYPE_BOX: {
+			const t_coll_box& b = m_boxes[ref.index];
+
+			// transform into box-space, then push out through the nearest face
+			const t_pos3f p = b.rot.inverse() * (pos - b.pos);
+			const t_vec3f d = b.half_ext - p.cwiseAbs();
+
+			if ((d.array() <= 0.0f).any())
+				return false;
+
+			size_t axis = consts::AXIS_IDX_X;
+
+			if (d.y() < d[axis]) axis = consts::AXIS_IDX_Y;
+			if (d.z() < d[axis]) axis = consts::AXIS_IDX_Z;
+
+			contact.normal = b.rot * (consts::WORLD_AXES[axis] * ((p[axis] < 0.0f)? -1.0f: 1.0f));
+			contact.depth = d[axis];
+			return true;
+		} break;
+		case PRIM_TYPE_TRIANGLE: {
+			const t_coll_triangle& t = m_triangles[ref.index];
+
+			const float dist = (pos - t.verts[0]).dot(t.normal);
+
+			if (dist >= 0.0f || dist <= -t.skin_depth)
+				return false;
+
+			// barycentric inside-test of the point projected onto the face
+			const t_pos3f p = pos - t.normal * dist;
+
+			for (size_t i = 0; i < 3; i++) {
+				const t_vec3f e = t.verts[(i + 1) % 3] - t.verts[i];
+
+				if (e.cross(p - t.verts[i]).dot(t.normal) < 0.0f)
+					return false;
+			}
+
+			contact.normal = t.normal;
+			contact.depth = -dist;
+			return true;
+		} break;
+		default: {
+			assert(false);
+		} break;
+	}
+
+	return false;
+}
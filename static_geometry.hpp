@@ -0,0 +1,154 @@
+#ifndef EIGENPHYSIKS_STATIC_GEOMETRY_HDR
+#define EIGENPHYSIKS_STATIC_GEOMETRY_HDR
+
+#include <vector>
+
+#include "eigen_types.hpp"
+#include "thread_pool.hpp"
+#include "world_consts.hpp"
+
+namespace epiks {
+	struct t_aabb {
+	public:
+		t_aabb() {
+			mins = { std::numeric_limits<float>::max(),  std::numeric_limits<float>::max(),  std::numeric_limits<float>::max()};
+			maxs = {-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max()};
+		}
+		t_aabb(const t_pos3f& mn, const t_pos3f& mx): mins(mn), maxs(mx) {}
+
+		void add_pos(const t_pos3f& p) { mins = mins.cwiseMin(p); maxs = maxs.cwiseMax(p); }
+		void add_box(const t_aabb& b) { mins = mins.cwiseMin(b.mins); maxs = maxs.cwiseMax(b.maxs); }
+
+		bool contains(const t_pos3f& p) const {
+			return ((p.array() >= mins.array()).all() && (p.array() <= maxs.array()).all());
+		}
+
+		t_pos3f get_center() const { return ((mins + maxs) * 0.5f); }
+		t_vec3f get_extent() const { return (maxs - mins); }
+
+	public:
+		t_pos3f mins;
+		t_pos3f maxs;
+	};
+
+
+	struct t_coll_sphere {
+		t_pos3f pos;
+		float radius;
+	};
+
+	struct t_coll_capsule {
+		t_pos3f pos0;
+		t_pos3f pos1;
+		float radius;
+	};
+
+	// oriented box; rot maps box-space to world-space
+	struct t_coll_box {
+		t_pos3f pos;
+		t_rot4f rot;
+		t_vec3f half_ext;
+	};
+
+	// one-sided; points behind the (CCW) face by less than skin_depth collide
+	struct t_coll_triangle {
+		t_pos3f verts[3];
+		t_vec3f normal;
+		float skin_depth;
+	};
+
+	struct t_coll_contact {
+		t_vec3f normal; // outward surface normal at contact
+		float depth; // penetration depth, zero means no contact
+	};
+
+
+	// collection of immovable collision primitives indexed by an AABB-tree
+	struct t_static_geometry {
+	public:
+		enum {
+			PRIM_TYPE_SPHERE   = 0,
+			PRIM_TYPE_CAPSULE  = 1,
+			PRIM_TYPE_BOX      = 2,
+			PRIM_TYPE_TRIANGLE = 3,
+		};
+
+		void add_sphere(const t_coll_sphere& s) { add_prim(PRIM_TYPE_SPHERE, m_spheres.size()); m_spheres.push_back(s); }
+		void add_capsule(const t_coll_capsule& c) { add_prim(PRIM_TYPE_CAPSULE, m_capsules.size()); m_capsules.push_back(c); }
+		void add_box(const t_coll_box& b) { add_prim(PRIM_TYPE_BOX, m_boxes.size()); m_boxes.push_back(b); }
+		void add_mesh(const std::vector<t_pos3f>& verts, const std::vector<uint32_t>& indices, float skin_depth);
+
+		// must be called after primitives are added and before any query
+		void build();
+		void clear();
+
+		bool empty() const { return m_bvh_nodes.empty(); }
+
+		// finds the deepest contact for a point; returns false if none
+		bool query_point(const t_pos3f& pos, t_coll_contact& contact) const;
+
+		// batched version of query_point, contacts[i] receives the result for
+		// get_pos(i) (zero depth if none); queries are spread over the pool
+		template<typename t_pos_func>
+		void query_points(size_t num_points, const t_pos_func& get_pos, t_coll_contact* contacts, util::t_thread_pool& pool) const {
+			pool.parallel_for(num_points, QUERY_CHUNK_SIZE, [&](size_t i) {
+				if (!query_point(get_pos(i), contacts[i]))
+					contacts[i].depth = 0.0f;
+			});
+		}
+
+	private:
+		struct t_prim_ref {
+			uint32_t type;
+			uint32_t index;
+		};
+
+		struct t_bvh_node {
+			t_aabb bbox;
+
+			// inner nodes have num_prims=0 and children {first_idx, first_idx+1}
+			uint32_t first_idx;
+			uint32_t num_prims;
+		};
+
+		void add_prim(uint32_t type, size_t index) { m_prim_refs.push_back({type, uint32_t(index)}); }
+
+		void build_node(size_t node_idx, size_t min_ref_idx, size_t max_ref_idx, std::vector<t_aabb>& prim_boxes);
+
+		t_aabb calc_prim_bbox(const t_prim_ref& ref) const;
+		bool calc_prim_contact(const t_prim_ref& ref, const t_pos3f& pos, t_coll_contact& contact) const;
+
+	private:
+		static constexpr size_t MAX_LEAF_PRIMS = 4;
+		static constexpr size_t QUERY_CHUNK_SIZE = 256;
+
+		std::vector<t_coll_sphere> m_spheres;
+		std::vector<t_coll_capsule> m_capsules;
+		std::vector<t_coll_box> m_boxes;
+		std::vector<t_coll_triangle> m_triangles;
+
+		std::vector<t_prim_ref> m_prim_refs;
+		std::vector<t_bvh_node> m_bvh_nodes;
+	};
+
+
+	// contact response; same friction/absorption/repulsion model as the ground-plane
+	// (which is the special case normal=<0,1,0>, depth=ground_plane_level-pos.y)
+	static inline t_vec3f calc_contact_force(const t_vec3f& vel, const t_coll_contact& contact, const t_world_params& params) {
+		const float   nrm_speed = vel.dot(contact.normal);
+		const t_vec3f nrm_vel = contact.normal * nrm_speed;
+		const t_vec3f tan_vel = vel - nrm_vel;
+
+		t_vec3f force = {0.0f, 0.0f, 0.0f};
+
+		// apply surface-friction force
+		force -= (tan_vel * params.ground_frict_coeff);
+		// absorb collision energy
+		force -= (nrm_vel * params.ground_absor_coeff * (nrm_speed < 0.0f));
+		// apply repulsion force (damped spring)
+		force += (contact.normal * params.ground_repul_coeff * contact.depth);
+		return force;
+	}
+};
+
+#endif
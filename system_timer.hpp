@@ -9,6 +9,7 @@ namespace util {
 		uint64_t tick_time() { return (tick(),           0); }
 		uint64_t tock_time() { return (tock(), diff_time()); }
 		uint64_t diff_time() const { return ((nsecs()).count()); }
+		uint64_t tick_stamp() const { return (std::chrono::duration_cast<std::chrono::nanoseconds>(t0.time_since_epoch()).count()); }
 
 	private:
 		std::chrono::high_resolution_clock::time_point& tick() { return (t0 = std::chrono::high_resolution_clock::now()); }
@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "telemetry.hpp"
+
+// sums of many such values still fit in 64 bits
+static constexpr double MAX_UNITS = 1ull << 48;
+
+util::t_telem_series::t_telem_series(const char* name, uint32_t kind, double resolution): m_name(name), m_kind(kind), m_resolution(resolution) {
+	m_id = t_telemetry::get_instance().register_series(this);
+}
+
+
+
+util::t_telemetry& util::t_telemetry::get_instance() {
+	static t_telemetry telemetry;
+	return telemetry;
+}
+
+uint32_t util::t_telemetry::register_series(const t_telem_series* series) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// checked in every build; series ids index fixed-size per-thread tables
+	if (m_series.size() == DROPPED_SERIES_ID) {
+		std::fprintf(stderr, "[telem::%s] more than %u series, \"%s\" is dropped\n", __func__, DROPPED_SERIES_ID, series->get_name());
+		return DROPPED_SERIES_ID;
+	}
+
+	m_series.push_back(series);
+	return (m_series.size() - 1);
+}
+
+util::t_telemetry::t_thread_state& util::t_telemetry::get_thread_state() {
+	static thread_local t_thread_state* state = nullptr;
+
+	if (state != nullptr)
+		return *state;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_thread_states.push_back(state = new t_thread_state());
+	return *state;
+}
+
+
+void util::t_telemetry::add_value(const t_telem_series& series, double value) {
+	// converting NaN (or anything out of range) to an integer is undefined
+	if (!std::isfinite(value))
+		return;
+
+	t_series_stats& ss = get_thread_state().series_stats[series.get_id()];
+
+	// quantized, so the profiler's integer histogram buckets can be reused
+	const uint64_t units = std::min(std::max(value / series.get_resolution() + 0.5, 0.0), MAX_UNITS);
+
+	ss.count.fetch_add(1, std::memory_order_relaxed);
+	ss.sum.fetch_add(units, std::memory_order_relaxed);
+	ss.hist[t_profiler::calc_bucket(units)].fetch_add(1, std::memory_order_relaxed);
+
+	if (units > ss.max.load(std::memory_order_relaxed))
+		ss.max.store(units, std::memory_order_relaxed);
+}
+
+
+bool util::t_telemetry::start_dump(const char* file_name) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_dump_file != nullptr)
+		std::fclose(m_dump_file);
+
+	if ((m_dump_file = std::fopen(file_name, "w")) == nullptr) {
+		std::fprintf(stderr, "[telem::%s] can not open \"%s\"\n", __func__, file_name);
+		return false;
+	}
+
+	const size_t len = std::strlen(file_name);
+
+	m_dump_json = (len >= 5 && std::strcmp(file_name + len - 5, ".json") == 0);
+	m_num_reports = 0;
+
+	if (!m_dump_json)
+		std::fprintf(m_dump_file, "report,name,kind,count,mean,p50,p99,max\n");
+
+	return true;
+}
+
+void util::t_telemetry::stop_dump() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_dump_file == nullptr)
+		return;
+
+	std::fclose(m_dump_file);
+	m_dump_file = nullptr;
+}
+
+
+void util::t_telemetry::output_stats(FILE* out) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	const size_t num_series = m_series.size();
+
+	std::vector<uint64_t> counts(num_series, 0);
+	std::vector<uint64_t> sums(num_series, 0);
+	std::vector<uint64_t> maxs(num_series, 0);
+	std::vector<uint64_t> hists(num_series * NUM_BUCKETS, 0);
+
+	// merge (and reset) all per-thread statistics
+	for (t_thread_state* ts: m_thread_states) {
+		for (size_t i = 0; i < num_series; i++) {
+			t_series_stats& ss = ts->series_stats[i];
+
+			counts[i] += ss.count.exchange(0, std::memory_order_relaxed);
+			sums[i] += ss.sum.exchange(0, std::memory_order_relaxed);
+			maxs[i] = std::max(maxs[i], uint64_t(ss.max.exchange(0, std::memory_order_relaxed)));
+
+			for (uint32_t b = 0; b < NUM_BUCKETS; b++) {
+				hists[i * NUM_BUCKETS + b] += ss.hist[b].exchange(0, std::memory_order_relaxed);
+			}
+		}
+	}
+
+	const auto calc_percentile = [&](size_t series_idx, float frac) {
+		const uint64_t rank = counts[series_idx] * frac;
+
+		uint64_t sum = 0;
+
+		for (uint32_t b = 0; b < NUM_BUCKETS; b++) {
+			if ((sum += hists[series_idx * NUM_BUCKETS + b]) > rank)
+				return (std::min(t_profiler::calc_bucket_time(b), maxs[series_idx]));
+		}
+
+		return maxs[series_idx];
+	};
+
+	if (m_dump_file != nullptr && m_dump_json)
+		std::fprintf(m_dump_file, "{\"report\":%lu,\"series\":[", (unsigned long) m_num_reports);
+
+	for (size_t i = 0, n = 0; i < num_series; i++) {
+		const t_telem_series& series = *m_series[i];
+		const bool is_value = (series.get_kind() == t_telem_series::KIND_VALUE);
+
+		// counters that did not fire are still reported, idle values are not
+		if (is_value && counts[i] == 0)
+			continue;
+
+		const double res = series.get_resolution();
+		const double mean = is_value? ((sums[i] * res) / counts[i]): 0.0;
+		const double p50 = is_value? (calc_percentile(i, 0.50f) * res): 0.0;
+		const double p99 = is_value? (calc_percentile(i, 0.99f) * res): 0.0;
+		const double max = is_value? (maxs[i] * res): 0.0;
+
+		if (is_value) {
+			std::fprintf(out, "[telem::output_stats] %-32s n=%-7lu mean=%-10g p50=%-10g p99=%-10g max=%g\n", series.get_name(), (unsigned long) counts[i], mean, p50, p99, max);
+		} else {
+			std::fprintf(out, "[telem::output_stats] %-32s n=%lu\n", series.get_name(), (unsigned long) counts[i]);
+		}
+
+		if (m_dump_file == nullptr)
+			continue;
+
+		if (m_dump_json) {
+			std::fprintf(m_dump_file, "%s{\"name\":\"%s\",\"count\":%lu", ((n++ != 0)? ",": ""), series.get_name(), (unsigned long) counts[i]);
+
+			if (is_value)
+				std::fprintf(m_dump_file, ",\"mean\":%g,\"p50\":%g,\"p99\":%g,\"max\":%g", mean, p50, p99, max);
+
+			std::fprintf(m_dump_file, "}");
+		} else {
+			std::fprintf(m_dump_file, "%lu,%s,%s,%lu,%g,%g,%g,%g\n", (unsigned long) m_num_reports, series.get_name(), (is_value? "value": "counter"), (unsigned long) counts[i], mean, p50, p99, max);
+		}
+	}
+
+	if (m_dump_file != nullptr) {
+		if (m_dump_json)
+			std::fprintf(m_dump_file, "]}\n");
+
+		std::fflush(m_dump_file);
+	}
+
+	m_num_reports += 1;
+}
@@ -0,0 +1,114 @@
+#ifndef EIGENPHYSIKS_TELEMETRY_HDR
+#define EIGENPHYSIKS_TELEMETRY_HDR
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+#include "profiler.hpp"
+
+namespace util {
+	// statically allocated name for a telemetry series; counters only add up
+	// occurrences, values also keep {mean,p50,p99,max} over a histogram of
+	// their magnitudes quantized to <resolution> (e.g. 1e-6 for micrometers)
+	struct t_telem_series {
+	public:
+		enum {
+			KIND_COUNTER = 0,
+			KIND_VALUE   = 1,
+		};
+
+	public:
+		t_telem_series(const char* name, uint32_t kind, double resolution = 1.0);
+
+		const char* get_name() const { return m_name; }
+		uint32_t get_kind() const { return m_kind; }
+		uint32_t get_id() const { return m_id; }
+
+		double get_resolution() const { return m_resolution; }
+
+	private:
+		const char* m_name;
+
+		uint32_t m_kind;
+		uint32_t m_id;
+
+		double m_resolution;
+	};
+
+
+	// always-on counters and gauges for algorithmic behavior (iterations,
+	// fallbacks, errors, energies), aggregated like t_profiler's zones: each
+	// thread adds to its own slots and output_stats drains all of them
+	struct t_telemetry {
+	public:
+		static constexpr uint32_t MAX_SERIES = 32;
+		static constexpr uint32_t NUM_BUCKETS = t_profiler::NUM_BUCKETS;
+
+		// series registered past MAX_SERIES share this slot, which is
+		// recorded into but never reported
+		static constexpr uint32_t DROPPED_SERIES_ID = MAX_SERIES - 1;
+
+		struct t_series_stats {
+			std::atomic<uint64_t> count = {0};
+			std::atomic<uint64_t> sum = {0}; // in units of resolution
+			std::atomic<uint64_t> max = {0};
+			std::atomic<uint32_t> hist[NUM_BUCKETS] = {};
+		};
+
+		struct t_thread_state {
+			t_series_stats series_stats[MAX_SERIES];
+		};
+
+	public:
+		static t_telemetry& get_instance();
+
+		uint32_t register_series(const t_telem_series* series);
+
+		void add_count(const t_telem_series& series, uint64_t n = 1) {
+			get_thread_state().series_stats[series.get_id()].count.fetch_add(n, std::memory_order_relaxed);
+		}
+
+		// negative values are recorded as zero; non-finite ones are dropped,
+		// callers count them in a series of their own (e.g. ik::nonfinite)
+		void add_value(const t_telem_series& series, double value);
+
+		// prints every series recorded since the previous call, and appends
+		// the same as one CSV row per series (or one JSON line) to the dump
+		void output_stats(FILE* out);
+
+		// the dump is JSON lines if file_name ends in ".json", CSV otherwise
+		bool start_dump(const char* file_name);
+		void stop_dump();
+
+	private:
+		t_thread_state& get_thread_state();
+
+	private:
+		std::mutex m_mutex;
+
+		// every thread that ever recorded anything; states are never freed
+		std::vector<t_thread_state*> m_thread_states;
+		std::vector<const t_telem_series*> m_series;
+
+		FILE* m_dump_file = nullptr;
+
+		bool m_dump_json = false;
+
+		uint64_t m_num_reports = 0;
+	};
+};
+
+
+// series are defined once at namespace scope, so counters that never fire
+// are still reported (as zero) and template instantiations share them
+#ifndef EIGENPHYSIKS_NO_TELEMETRY
+#define EIGENPHYSIKS_TELEM_COUNT(series, n) util::t_telemetry::get_instance().add_count(series, n)
+#define EIGENPHYSIKS_TELEM_VALUE(series, value) util::t_telemetry::get_instance().add_value(series, value)
+#else
+#define EIGENPHYSIKS_TELEM_COUNT(series, n) do { } while (false)
+#define EIGENPHYSIKS_TELEM_VALUE(series, value) do { } while (false)
+#endif
+
+#endif
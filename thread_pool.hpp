@@ -0,0 +1,146 @@
+#ifndef EIGENPHYSIKS_THREAD_POOL_HDR
+#define EIGENPHYSIKS_THREAD_POOL_HDR
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace util {
+	// fixed set of worker threads executing chunked parallel-for jobs; the
+	// calling thread participates in every job and blocks until it is done
+	struct t_thread_pool {
+	public:
+		t_thread_pool(size_t num_threads = std::thread::hardware_concurrency()) {
+			// calling thread counts as one of the workers
+			m_workers.reserve(std::max(num_threads, size_t(1)) - 1);
+
+			for (size_t i = 1; i < num_threads; i++) {
+				m_workers.emplace_back([this]() { worker_loop(); });
+			}
+		}
+		~t_thread_pool() {
+			{
+				std::lock_guard<std::mutex> lock(m_job_mutex);
+				m_kill_workers = true;
+			}
+
+			m_job_cond.notify_all();
+
+			for (std::thread& t: m_workers) {
+				t.join();
+			}
+		}
+
+		t_thread_pool(const t_thread_pool&) = delete;
+		t_thread_pool& operator = (const t_thread_pool&) = delete;
+
+		// calls func(i) for each i in [0, num_items); items are handed out
+		// in chunks of <chunk_size> so per-item dispatch cost is amortized
+		template<typename t_func>
+		void parallel_for(size_t num_items, size_t chunk_size, const t_func& func) {
+			const size_t num_chunks = (num_items + chunk_size - 1) / chunk_size;
+
+			if (num_chunks <= 1 || m_workers.empty()) {
+				for (size_t i = 0; i < num_items; i++) {
+					func(i);
+				}
+				return;
+			}
+
+			const std::function<void(size_t)> chunk_func = [&](size_t chunk_idx) {
+				const size_t min_idx = chunk_idx * chunk_size;
+				const size_t max_idx = std::min(min_idx + chunk_size, num_items);
+
+				for (size_t i = min_idx; i < max_idx; i++) {
+					func(i);
+				}
+			};
+
+			{
+				std::lock_guard<std::mutex> lock(m_job_mutex);
+
+				m_job_func = &chunk_func;
+				m_num_chunks = num_chunks;
+				m_next_chunk = 0;
+				m_done_chunks = 0;
+				m_job_index += 1;
+			}
+
+			m_job_cond.notify_all();
+			exec_chunks();
+
+			{
+				std::unique_lock<std::mutex> lock(m_job_mutex);
+				// wait for stragglers too, so none can touch the next job's state
+				m_done_cond.wait(lock, [&]() { return (m_done_chunks == m_num_chunks && m_busy_workers == 0); });
+				m_job_func = nullptr;
+			}
+		}
+
+		size_t get_num_threads() const { return (m_workers.size() + 1); }
+
+	private:
+		void worker_loop() {
+			for (uint64_t last_job_index = 0; ; ) {
+				{
+					std::unique_lock<std::mutex> lock(m_job_mutex);
+					m_job_cond.wait(lock, [&]() { return (m_kill_workers || (m_job_func != nullptr && m_job_index != last_job_index)); });
+
+					if (m_kill_workers)
+						return;
+
+					last_job_index = m_job_index;
+					m_busy_workers += 1;
+				}
+
+				exec_chunks();
+
+				{
+					std::lock_guard<std::mutex> lock(m_job_mutex);
+					m_busy_workers -= 1;
+				}
+
+				m_done_cond.notify_one();
+			}
+		}
+
+		void exec_chunks() {
+			size_t num_done = 0;
+
+			for (size_t chunk_idx = m_next_chunk++; chunk_idx < m_num_chunks; chunk_idx = m_next_chunk++) {
+				(*m_job_func)(chunk_idx);
+				num_done += 1;
+			}
+
+			if (num_done == 0)
+				return;
+
+			std::lock_guard<std::mutex> lock(m_job_mutex);
+			m_done_chunks += num_done;
+		}
+
+	private:
+		std::vector<std::thread> m_workers;
+
+		std::mutex m_job_mutex;
+		std::condition_variable m_job_cond;
+		std::condition_variable m_done_cond;
+
+		const std::function<void(size_t)>* m_job_func = nullptr;
+
+		std::atomic<size_t> m_next_chunk = {0};
+
+		size_t m_num_chunks = 0;
+		size_t m_done_chunks = 0;
+		size_t m_busy_workers = 0;
+		uint64_t m_job_index = 0;
+
+		bool m_kill_workers = false;
+	};
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef EIGENPHYSIKS_TICK_RATE_HDR
+#define EIGENPHYSIKS_TICK_RATE_HDR
+
+#include <algorithm>
+#include <cmath>
+
+namespace util {
+	// rate of one subsystem relative to the base tick-rate; slower rates run
+	// on every N-th tick, faster ones run N sub-steps per tick; both are
+	// rounded to whole numbers, so the schedule only depends on tick indices
+	struct t_tick_rate {
+	public:
+		t_tick_rate(uint32_t rate_hz = 1, uint32_t base_rate_hz = 1) {
+			rate_hz = std::max(rate_hz, 1u);
+
+			m_tick_period = std::max(uint32_t(std::lround(double(base_rate_hz) / rate_hz)), 1u);
+			m_num_substeps = std::max(uint32_t(std::lround(double(rate_hz) / base_rate_hz)), 1u);
+			m_rate_hz = (base_rate_hz * m_num_substeps) / float(m_tick_period);
+		}
+
+		bool is_due(uint64_t tick) const { return ((tick % m_tick_period) == 0); }
+
+		// fraction of the current period that has passed at the end of tick
+		float calc_phase(uint64_t tick) const { return (((tick % m_tick_period) + 1) / float(m_tick_period)); }
+		// time covered by one (sub)step at this rate
+		float calc_step_size(float base_dt) const { return ((base_dt * m_tick_period) / m_num_substeps); }
+
+		uint32_t get_tick_period() const { return m_tick_period; }
+		uint32_t get_num_substeps() const { return m_num_substeps; }
+
+		// effective rate after rounding
+		float get_rate_hz() const { return m_rate_hz; }
+
+	private:
+		uint32_t m_tick_period;
+		uint32_t m_num_substeps;
+
+		float m_rate_hz;
+	};
+};
+
+#endif
@@ -0,0 +1,126 @@
+#include <chrono>
+#include <cstdlib>
+
+#include "trace_writer.hpp"
+
+static uint64_t get_clock_time_ns() {
+	// same clock as t_system_timer, whose tick-stamps become event start times
+	return (std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count());
+}
+
+
+util::t_trace_writer& util::t_trace_writer::get_instance() {
+	// never destroyed; threads may still record while static destructors run
+	static t_trace_writer* writer = new t_trace_writer();
+	return *writer;
+}
+
+util::t_trace_writer::t_thread_ring& util::t_trace_writer::get_thread_ring() {
+	static thread_local t_thread_ring* ring = nullptr;
+
+	if (ring != nullptr)
+		return *ring;
+
+	std::lock_guard<std::mutex> lock(m_rings_mutex);
+	m_thread_rings.push_back(ring = new t_thread_ring());
+	ring->thread_id = m_thread_rings.size();
+	return *ring;
+}
+
+
+bool util::t_trace_writer::start(const char* file_name) {
+	if (m_enabled)
+		return false;
+	if ((m_file = std::fopen(file_name, "w")) == nullptr)
+		return false;
+
+	std::fprintf(m_file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+	m_base_time_ns = get_clock_time_ns();
+	m_num_written = 0;
+	m_num_dropped = 0;
+	m_enabled = true;
+	m_flush_thread = std::thread([this]() { flush_loop(); });
+
+	// also finish the file if the process leaves via exit()
+	static bool registered = false;
+
+	if (!registered)
+		std::atexit([]() { t_trace_writer::get_instance().stop(); });
+
+	registered = true;
+	return true;
+}
+
+void util::t_trace_writer::stop() {
+	if (!m_enabled)
+		return;
+
+	m_enabled = false;
+	m_flush_thread.join();
+
+	flush_rings();
+
+	std::fprintf(m_file, "\n]}\n");
+	std::fclose(m_file);
+	std::fprintf(stdout, "[tw::%s] wrote %lu events (%lu dropped)\n", __func__, (unsigned long) m_num_written, (unsigned long) m_num_dropped.load());
+
+	m_file = nullptr;
+}
+
+
+void util::t_trace_writer::add_event(const char* name, uint64_t start_ns, uint64_t dur_ns, const char* arg_name, int64_t arg_value) {
+	t_thread_ring& ring = get_thread_ring();
+
+	const uint32_t w = ring.write_idx.load(std::memory_order_relaxed);
+	const uint32_t r = ring.read_idx.load(std::memory_order_acquire);
+
+	if ((w - r) >= RING_SIZE) {
+		m_num_dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	ring.events[w & RING_MASK] = {name, arg_name, start_ns, dur_ns, arg_value};
+	ring.write_idx.store(w + 1, std::memory_order_release);
+}
+
+
+void util::t_trace_writer::flush_loop() {
+	while (m_enabled) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(FLUSH_INTERVAL_MS));
+		flush_rings();
+	}
+}
+
+void util::t_trace_writer::flush_rings() {
+	std::lock_guard<std::mutex> lock(m_rings_mutex);
+
+	for (t_thread_ring* ring: m_thread_rings) {
+		const uint32_t r = ring->read_idx.load(std::memory_order_relaxed);
+		const uint32_t w = ring->write_idx.load(std::memory_order_acquire);
+
+		for (uint32_t i = r; i != w; i++) {
+			const t_trace_event& e = ring->events[i & RING_MASK];
+
+			// events recorded before start (by a previous session) are dropped
+			if (e.start_ns < m_base_time_ns)
+				continue;
+
+			std::fprintf(m_file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+				(m_num_written++ == 0)? "": ",\n",
+				e.name,
+				ring->thread_id,
+				(e.start_ns - m_base_time_ns) * 1e-3,
+				e.dur_ns * 1e-3
+			);
+
+			if (e.arg_name != nullptr) {
+				std::fprintf(m_file, ",\"args\":{\"%s\":%ld}}", e.arg_name, long(e.arg_value));
+			} else {
+				std::fprintf(m_file, "}");
+			}
+		}
+
+		ring->read_idx.store(w, std::memory_order_release);
+	}
+}
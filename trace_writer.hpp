@@ -0,0 +1,70 @@
+#ifndef EIGENPHYSIKS_TRACE_WRITER_HDR
+#define EIGENPHYSIKS_TRACE_WRITER_HDR
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace util {
+	struct t_trace_event {
+		const char* name;
+		const char* arg_name; // optional, nullptr if event has no argument
+
+		uint64_t start_ns;
+		uint64_t dur_ns;
+
+		int64_t arg_value;
+	};
+
+	// streams complete-duration events to a Chrome trace-event JSON file
+	// (loadable by chrome://tracing and Perfetto); every producer thread owns
+	// a single-producer ring which a background thread drains periodically,
+	// so recording never blocks on I/O and full rings just drop events
+	struct t_trace_writer {
+	public:
+		static t_trace_writer& get_instance();
+
+		bool start(const char* file_name);
+		void stop();
+
+		bool is_enabled() const { return (m_enabled.load(std::memory_order_relaxed)); }
+
+		void add_event(const char* name, uint64_t start_ns, uint64_t dur_ns, const char* arg_name = nullptr, int64_t arg_value = 0);
+
+	private:
+		static constexpr uint32_t RING_SIZE = 1 << 14;
+		static constexpr uint32_t RING_MASK = RING_SIZE - 1;
+		static constexpr uint32_t FLUSH_INTERVAL_MS = 10;
+
+		struct t_thread_ring {
+			t_trace_event events[RING_SIZE];
+
+			std::atomic<uint32_t> write_idx = {0};
+			std::atomic<uint32_t> read_idx = {0};
+
+			uint32_t thread_id = 0;
+		};
+
+		t_thread_ring& get_thread_ring();
+
+		void flush_loop();
+		void flush_rings();
+
+	private:
+		std::mutex m_rings_mutex;
+		std::vector<t_thread_ring*> m_thread_rings;
+
+		std::thread m_flush_thread;
+		std::atomic<bool> m_enabled = {false};
+		std::atomic<uint64_t> m_num_dropped = {0};
+
+		FILE* m_file = nullptr;
+
+		uint64_t m_base_time_ns = 0;
+		uint64_t m_num_written = 0;
+	};
+};
+
+#endif
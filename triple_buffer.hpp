@@ -0,0 +1,50 @@
+#ifndef EIGENPHYSIKS_TRIPLE_BUFFER_HDR
+#define EIGENPHYSIKS_TRIPLE_BUFFER_HDR
+
+#include <atomic>
+
+namespace util {
+	// single-producer single-consumer exchange of whole values; the writer
+	// fills the back slot and swaps it with the middle one, the reader swaps
+	// its front slot with the middle one whenever a new value was published
+	// neither side ever blocks, and each owns its slot exclusively meanwhile
+	template<typename t_value>
+	struct t_triple_buffer {
+	public:
+		t_value& get_back() { return m_slots[m_back_idx]; }
+		const t_value& get_front() const { return m_slots[m_front_idx]; }
+
+		// writer-side; makes the back slot visible to the reader
+		void publish() {
+			m_back_idx = m_middle.exchange(m_back_idx | DIRTY_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+		}
+
+		// reader-side; true if consume would return a newer value
+		bool pending() const { return ((m_middle.load(std::memory_order_relaxed) & DIRTY_BIT) != 0); }
+
+		// reader-side; returns true if front now holds a newer value
+		bool consume() {
+			if (!pending())
+				return false;
+
+			m_front_idx = m_middle.exchange(m_front_idx, std::memory_order_acq_rel) & INDEX_MASK;
+			return true;
+		}
+
+		// only safe while neither side is active, e.g. to pre-size all slots
+		t_value& get_slot(size_t i) { return m_slots[i]; }
+
+	private:
+		static constexpr uint8_t INDEX_MASK = 0x3;
+		static constexpr uint8_t DIRTY_BIT = 0x4;
+
+		t_value m_slots[3];
+
+		uint8_t m_front_idx = 0;
+		uint8_t m_back_idx = 1;
+
+		std::atomic<uint8_t> m_middle = {2};
+	};
+};
+
+#endif
@@ -4,41 +4,48 @@
 #include <cstdio> // std::fprintf
 
 #include "global_consts.hpp"
+#include "profiler.hpp"
+#include "telemetry.hpp"
 
 namespace util {
 	struct t_wall_clock {
 	public:
 		bool update(uint64_t tock_time) {
-			render_time_ns += (tock_time * render_dt_mult);
-			system_time_ns += (tock_time                 );
+			sim_debt_ns    += (tock_time * sim_dt_mult);
+			system_time_ns += (tock_time              );
 			n_render_calls += 1;
 
 			return (system_time_ns >= consts::WALL_SEC_TIME_NS);
 		}
 
-		void inv_render_dt_mult() { render_dt_mult = 1 - render_dt_mult; }
-		void add_render_time_ns(uint64_t dt) { render_time_ns += dt; }
+		void inv_sim_dt_mult() { sim_dt_mult = 1 - sim_dt_mult; }
+		void add_sim_debt_ns(uint64_t dt) { sim_debt_ns += dt; }
 		void add_update_time_ns(uint64_t dt) { update_time_ns += dt; }
 		void add_system_time_ns(uint64_t dt) { system_time_ns += dt; }
+		void set_sim_debt_ns(uint64_t t) { sim_debt_ns = t; }
 
 		void output_timings(FILE* out) {
-			std::fprintf(out, "[wc::%s] {update,render}_calls={%u,%u}\n", __func__, n_update_calls, n_render_calls);
+			std::fprintf(out, "[wc::%s] {update,render}_calls={%u,%u} update_time=%.3fs sim_debt=%.3fs\n", __func__, n_update_calls, n_render_calls, update_time_ns * 1e-9, sim_debt_ns * 1e-9);
+
+			// per-zone breakdown and solver/physics counters of the last second
+			t_profiler::get_instance().output_stats(out);
+			t_telemetry::get_instance().output_stats(out);
 		}
 
 		uint32_t add_update_call() { return (n_update_calls++); }
 
-		uint64_t get_render_time_ns() const { return render_time_ns; }
+		uint64_t get_sim_debt_ns() const { return sim_debt_ns; }
 		uint64_t get_system_time_ns() const { return system_time_ns; }
 
 	private:
 		uint32_t n_update_calls = 0; // total number of Update calls executed
 		uint32_t n_render_calls = 0; // total number of Render calls executed
 
-		uint32_t render_dt_mult = 1; // if 0, renderer produces no time for simulation
+		uint32_t sim_dt_mult = 1; // if 0, rendering produces no time for simulation (paused)
 
 		uint64_t system_time_ns = 0; // total time (ns) spent in Update+Render calls
 		uint64_t update_time_ns = 0; // total time (ns) spent in Update calls
-		uint64_t render_time_ns = 0; // total time (ns) spent in Render calls
+		uint64_t sim_debt_ns = 0; // wall time (ns) rendered but not yet simulated; consumed per tick
 	};
 };
 
@@ -10,7 +10,6 @@ namespace epiks {
 		float dummy_var;
 
 		t_vec3f gravity_acc;
-		t_vec3f pulling_acc;
 	};
 
 	struct t_spring_anchor {
@@ -22,6 +21,7 @@ namespace epiks {
 
 	struct t_spring_base_params {
 		float rest_length;
+		float thickness; // self-collision distance, zero disables
 		float stiff_const; // stiffness
 		float frict_const; // internal damping
 	};
@@ -53,10 +53,10 @@ namespace consts {
 	//   ground-repulsion and spring-stiffness can not be too large
 	//   or the simulation will numerically blow up, depends on the
 	//   time-step size and integration method
-	static const     epiks::t_spring_grid_params ROPE_PARAMS = {1, 30,  0.05f, 0.0f,  {0.0f, -9.81f, 0.0f}, {0.0f, 0.0f, 0.0f}};
+	static const     epiks::t_spring_grid_params ROPE_PARAMS = {1, 30,  0.05f, 0.0f,  {0.0f, -9.81f, 0.0f}};
 	static const     epiks::t_spring_anchor      ROPE_ANCHOR = {0, {0.0f, 5.0f, 0.0f}, {0.0f, 0.0f, 0.0f}};
 
-	static constexpr epiks::t_spring_base_params SPRING_PARAMS = {0.05f, 100.0f, 0.2f};
+	static constexpr epiks::t_spring_base_params SPRING_PARAMS = {0.05f, 0.0f, 100.0f, 0.2f};
 	static constexpr epiks::t_world_params WORLD_PARAMS = {0.02f, 100.0f, 0.2f, 2.0f, 0.0f, 5.0f};
 
 	static const t_vec3f WORLD_AXES[AXIS_IDX_XYZ + 1] = {